@@ -4,6 +4,10 @@
 */
 
 #include "globals.h"
+#include "string.h"
+#include "windows.h"
+
+using namespace std;
 
 U64 between[64][64] = { 0i64 }; //Masks for squares in between pairs of squares
 
@@ -111,6 +115,106 @@ int In_Check(int side, BOARD_STRUCT *board)
 	return Under_Attack(king_square, side ^ 1, board);
 }
 
+//Returns a bitboard of the pieces of both sides that attack a square, sliders are blocked by occ
+U64 Attackers_To(int sq, U64 occ, BOARD_STRUCT *board)
+{
+	const U64 *pieces = board->piece_bitboards;
+
+	return (bpawn_attack_masks[sq] & pieces[wP])
+		| (wpawn_attack_masks[sq] & pieces[bP])
+		| (knight_attack_masks[sq] & (pieces[wN] | pieces[bN]))
+		| (Bishop_Attacks(occ, sq) & (pieces[wB] | pieces[wQ] | pieces[bB] | pieces[bQ]))
+		| (Rook_Attacks(occ, sq) & (pieces[wR] | pieces[wQ] | pieces[bR] | pieces[bQ]))
+		| (king_attack_masks[sq] & (pieces[wK] | pieces[bK]));
+}
+
+/***** Attack Info *****/
+/* Attack maps for both sides, computed once per position and shared by in check tests, evaluation and move ordering */
+
+//Adds the attacks of one piece to its side's maps
+static inline void Add_Attacks(U64 attacks, int piece, int side, ATTACK_INFO_STRUCT *ai)
+{
+	ai->piece_attacks[piece] |= attacks;
+	ai->double_attacks[side] |= ai->side_attacks[side] & attacks;
+	ai->side_attacks[side] |= attacks;
+}
+
+//Fills every attack map for the current position
+void Compute_Attack_Info(ATTACK_INFO_STRUCT *ai, BOARD_STRUCT *board)
+{
+	const U64 occ = board->side_bitboards[BOTH];
+	U64 temp, attacks;
+	int sq, side, piece;
+
+	memset(ai, 0, sizeof(ATTACK_INFO_STRUCT));
+	ai->hash = board->hash_key;
+
+	//Pawns, shifted together
+	temp = board->piece_bitboards[wP];
+	ai->piece_attacks[wP] = ((temp << 7) & ~file_masks[FILE_H]) | ((temp << 9) & ~file_masks[FILE_A]);
+	ai->double_attacks[WHITE] = ((temp << 7) & ~file_masks[FILE_H]) & ((temp << 9) & ~file_masks[FILE_A]);
+	ai->side_attacks[WHITE] = ai->piece_attacks[wP];
+
+	temp = board->piece_bitboards[bP];
+	ai->piece_attacks[bP] = ((temp >> 9) & ~file_masks[FILE_H]) | ((temp >> 7) & ~file_masks[FILE_A]);
+	ai->double_attacks[BLACK] = ((temp >> 9) & ~file_masks[FILE_H]) & ((temp >> 7) & ~file_masks[FILE_A]);
+	ai->side_attacks[BLACK] = ai->piece_attacks[bP];
+
+	//King zones are needed before the pieces are counted against them
+	int king_square[2];
+	for (side = WHITE; side <= BLACK; side++)
+	{
+		temp = board->piece_bitboards[side == WHITE ? wK : bK];
+		king_square[side] = pop_1st_bit(&temp);
+		ai->king_zone[side] = king_attack_masks[king_square[side]] | (1i64 << king_square[side]);
+	}
+
+	//Knights, bishops, rooks and queens
+	for (side = WHITE; side <= BLACK; side++)
+	{
+		const int first = (side == WHITE) ? wN : bN;
+		const U64 unsafe = board->side_bitboards[side] | ai->piece_attacks[side == WHITE ? bP : wP];
+
+		for (piece = first; piece < first + 4; piece++)
+		{
+			temp = board->piece_bitboards[piece];
+			while (temp)
+			{
+				sq = pop_1st_bit(&temp);
+
+				if (IS_KNIGHT(piece)) attacks = knight_attack_masks[sq];
+				else if (IS_BISHOP(piece)) attacks = Bishop_Attacks(occ, sq);
+				else if (IS_ROOK(piece)) attacks = Rook_Attacks(occ, sq);
+				else attacks = Bishop_Attacks(occ, sq) | Rook_Attacks(occ, sq);
+
+				Add_Attacks(attacks, piece, side, ai);
+				ai->mobility[side] += count_1s(attacks & ~unsafe);
+				if (attacks & ai->king_zone[side ^ 1])
+				{
+					ai->king_zone_attackers[side ^ 1]++;
+					ai->king_attack_units[side ^ 1] += king_attack_weights[piece];
+				}
+			}
+		}
+	}
+
+	//Kings
+	Add_Attacks(king_attack_masks[king_square[WHITE]], wK, WHITE, ai);
+	Add_Attacks(king_attack_masks[king_square[BLACK]], bK, BLACK, ai);
+
+	ai->checkers = Attackers_To(king_square[board->side], occ, board) & board->side_bitboards[board->side ^ 1];
+}
+
+//Returns the attack info for the current position, computed only if the position has changed since the last call at this ply
+ATTACK_INFO_STRUCT *Get_Attack_Info(BOARD_STRUCT *board)
+{
+	ATTACK_INFO_STRUCT *ai = &board->attack_info[min(board->hply, MAX_SEARCH_DEPTH)];
+
+	if (ai->hash != board->hash_key) Compute_Attack_Info(ai, board);
+
+	return ai;
+}
+
 
 //Fills between array
 void Generate_Between_Squares(void)
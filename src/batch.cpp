@@ -0,0 +1,223 @@
+/* batch.cpp
+* Contains the eval only batch mode for scoring large position files
+* Theo Kanning
+*/
+
+#include "globals.h"
+#include "stdio.h"
+#include "string.h"
+#include "stdlib.h"
+#include "windows.h"
+#include <thread>
+
+using namespace std;
+
+#define BATCH_SIZE			65536 //Positions read, scored and written together
+#define BATCH_LINE_LENGTH	128 //Longest fen kept, the rest of a line is ignored
+
+/* Input is one fen or epd per line, only the first six fields are read and missing clocks count as "0 1"
+Output is either csv lines of "fen,score" or little endian 16 bit scores in input order
+Scores are in centipawns for the side to move, lines that are not positions score 0 */
+
+typedef struct
+{
+	char (*fens)[BATCH_LINE_LENGTH];
+	short *scores;
+	int num;
+	std::atomic<int> next; //Next position to hand out
+	int use_qs;
+}BATCH_STRUCT;
+
+//Copies up to max whitespace separated fields of a line, returns the number found
+static int Split_Fields(char *line, char fields[][BATCH_LINE_LENGTH], int max_fields)
+{
+	int num = 0;
+
+	while (num < max_fields)
+	{
+		while (*line == ' ' || *line == '\t') line++;
+		if (*line == '\0') break;
+
+		int length = (int)strcspn(line, " \t");
+		memcpy(fields[num], line, min(length, BATCH_LINE_LENGTH - 1));
+		fields[num][min(length, BATCH_LINE_LENGTH - 1)] = '\0';
+		line += length;
+		num++;
+	}
+
+	return num;
+}
+
+//Splits the first six fields of a line, clocks that are missing or not short numbers become "0 1"
+//Returns 0 if the line is not a position
+static int Get_Fen_Fields(char *line, char fields[6][BATCH_LINE_LENGTH])
+{
+	int num = Split_Fields(line, fields, 6);
+
+	if (num < 4) return 0;
+
+	//Parse_Fen trusts its input, so the board must fill exactly eight ranks of eight with one king each
+	int squares = 0, ranks = 1, white_kings = 0, black_kings = 0;
+	for (char *c = fields[0]; *c; c++)
+	{
+		if (*c == '/')
+		{
+			if (squares != 8 * ranks) return 0;
+			ranks++;
+		}
+		else if (*c >= '1' && *c <= '8') squares += *c - '0';
+		else if (strchr("pnbrqkPNBRQK", *c)) squares++;
+		else return 0;
+
+		if (*c == 'K') white_kings++;
+		if (*c == 'k') black_kings++;
+	}
+	if (ranks != 8 || squares != 64 || white_kings != 1 || black_kings != 1) return 0;
+
+	if (strcmp(fields[1], "w") && strcmp(fields[1], "b")) return 0;
+	if (strspn(fields[2], "KQkq-") != strlen(fields[2])) return 0;
+	if (strcmp(fields[3], "-") && (strlen(fields[3]) != 2 || fields[3][0] < 'a' || fields[3][0] > 'h' || (fields[3][1] != '3' && fields[3][1] != '6'))) return 0;
+
+	//Epd operations can follow the fourth field, Parse_Fen reads at most two digits of each clock
+	if (num < 6 || strlen(fields[4]) > 2 || strlen(fields[5]) > 2 || strspn(fields[4], "0123456789") != strlen(fields[4]) || strspn(fields[5], "0123456789") != strlen(fields[5]))
+	{
+		memcpy(fields[4], "0", 2);
+		memcpy(fields[5], "1", 2);
+	}
+
+	return 1;
+}
+
+//Scores positions from the batch until none are left, each worker has its own board and pawn table
+//and the transposition table is not used, so a score does not depend on the other positions or threads
+static void Batch_Worker(BATCH_STRUCT *batch)
+{
+	BOARD_STRUCT *board = new BOARD_STRUCT;
+	SEARCH_INFO_STRUCT *info = new SEARCH_INFO_STRUCT;
+	char fields[6][BATCH_LINE_LENGTH];
+	char fen[BATCH_LINE_LENGTH * 2];
+	int index;
+
+	memset(board, 0, sizeof(BOARD_STRUCT));
+	Clear_Search_Info(info);
+	info->time_set = 0;
+	info->quit = 0;
+	info->age = 0;
+	info->max_depth = 0;
+	info->use_hash = 0;
+	Alloc_Thread_Pawn_Hash_Table();
+
+	while ((index = batch->next++) < batch->num)
+	{
+		if (!Get_Fen_Fields(batch->fens[index], fields))
+		{
+			batch->scores[index] = 0;
+			continue;
+		}
+		sprintf_s(fen, "%s %s %s %s %s %s", fields[0], fields[1], fields[2], fields[3], fields[4], fields[5]);
+
+		Parse_Fen(fen, board);
+		board->hply = 0; //Quiescent search depth is counted from here
+
+		int score = batch->use_qs ? Quiescent_Search(-INF, INF, board, info) : Evaluate_Board(board);
+		batch->scores[index] = (short)max(-MATE_SCORE, min(MATE_SCORE, score));
+	}
+
+	Free_Thread_Pawn_Hash_Table();
+	delete info;
+	delete board;
+}
+
+//Scores every position in a file and writes the results to another
+//Command is "eval_batch <input> <output> [bin] [qs] [threads n]", bin selects 16 bit output, qs adds a quiescent search
+//and threads sets the number of workers, one per core if not given
+void Eval_Batch(char *line)
+{
+	char args[8][BATCH_LINE_LENGTH];
+	int num_args = Split_Fields(line, args, 8);
+	int bin = 0, qs = 0, threads = 0;
+	FILE *in, *out;
+	BATCH_STRUCT batch;
+	std::thread workers[MAX_THREADS];
+	long total = 0;
+	int start_time = Get_Time_Ms();
+
+	if (num_args < 3)
+	{
+		printf("Usage: eval_batch <input> <output> [bin] [qs] [threads n]\n");
+		return;
+	}
+	for (int i = 3; i < num_args; i++)
+	{
+		if (!strcmp(args[i], "bin")) bin = 1;
+		else if (!strcmp(args[i], "qs")) qs = 1;
+		else if (!strcmp(args[i], "threads") && i + 1 < num_args) threads = atoi(args[++i]);
+	}
+
+	if (fopen_s(&in, args[1], "r") != 0 || in == NULL)
+	{
+		printf("Could not open %s\n", args[1]);
+		return;
+	}
+	if (fopen_s(&out, args[2], bin ? "wb" : "w") != 0 || out == NULL)
+	{
+		printf("Could not open %s\n", args[2]);
+		fclose(in);
+		return;
+	}
+
+	if (threads <= 0) threads = (int)std::thread::hardware_concurrency();
+	threads = max(1, min(threads, MAX_THREADS));
+
+	batch.fens = new char[BATCH_SIZE][BATCH_LINE_LENGTH];
+	batch.scores = new short[BATCH_SIZE];
+	batch.use_qs = qs;
+
+	printf("Eval batch started, %d threads, %s output%s\n", threads, bin ? "binary" : "csv", qs ? ", quiescent search" : "");
+
+	while (1)
+	{
+		//Read the next batch, lines longer than the buffer are cut and the rest skipped
+		batch.num = 0;
+		while (batch.num < BATCH_SIZE && fgets(batch.fens[batch.num], BATCH_LINE_LENGTH, in))
+		{
+			char *line = batch.fens[batch.num];
+			if (strchr(line, '\n') == NULL && !feof(in))
+			{
+				int c;
+				while ((c = fgetc(in)) != '\n' && c != EOF);
+			}
+			line[strcspn(line, "\r\n")] = '\0';
+			batch.num++;
+		}
+		if (batch.num == 0) break;
+
+		batch.next = 0;
+		for (int i = 0; i < threads; i++) workers[i] = std::thread(Batch_Worker, &batch);
+		for (int i = 0; i < threads; i++) workers[i].join();
+
+		//Results keep the input order
+		if (bin)
+		{
+			for (int i = 0; i < batch.num; i++)
+			{
+				unsigned char bytes[2] = { (unsigned char)(batch.scores[i] & 0xff), (unsigned char)((batch.scores[i] >> 8) & 0xff) };
+				fwrite(bytes, 1, 2, out);
+			}
+		}
+		else
+		{
+			for (int i = 0; i < batch.num; i++) fprintf(out, "%s,%d\n", batch.fens[i], batch.scores[i]);
+		}
+
+		total += batch.num;
+	}
+
+	int time = max(1, Get_Time_Ms() - start_time);
+	printf("Positions:%ld Time:%d Positions/sec:%ld\n", total, time, (long)(total * 1000.0 / time));
+
+	delete[] batch.fens;
+	delete[] batch.scores;
+	fclose(in);
+	fclose(out);
+}
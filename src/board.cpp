@@ -3,6 +3,7 @@
 * Theo Kanning 11/28/14 */
 #include "globals.h"
 #include <stdio.h>
+#include <stddef.h>
 #include <iostream>
 
 //#include "stdafx.h"
@@ -246,6 +247,8 @@ void Parse_Fen(char *fen, BOARD_STRUCT *board)
 
 	Compute_Hash(board);
 
+	if (use_nnue) NN_Refresh_Accumulator(board);
+
 #ifdef DEBUG
 	Check_Board(board);
 #endif
@@ -266,8 +269,7 @@ void Add_To_Piecelists(int piece, int square, BOARD_STRUCT *board)
 		SET_BIT(board->side_bitboards[WHITE], square);
 		SET_BIT(board->side_bitboards[BOTH], square);
 
-		board->middle_piece_square_score += middle_piece_square_tables[piece][square];
-		board->end_piece_square_score += end_piece_square_tables[piece][square];
+		board->piece_square_score += piece_square_tables[piece][square];
 
 		if (piece == wP) //Update pawn material
 		{
@@ -283,8 +285,7 @@ void Add_To_Piecelists(int piece, int square, BOARD_STRUCT *board)
 		SET_BIT(board->side_bitboards[BLACK], square);
 		SET_BIT(board->side_bitboards[BOTH], square);
 
-		board->middle_piece_square_score -= middle_piece_square_tables[piece][square];
-		board->end_piece_square_score -= end_piece_square_tables[piece][square];
+		board->piece_square_score -= piece_square_tables[piece][square];
 
 		if (piece == bP) //Update pawn material
 		{
@@ -315,8 +316,7 @@ void Remove_From_Piecelists(int piece, int square, BOARD_STRUCT *board)
 		CLR_BIT(board->side_bitboards[WHITE], square);
 		CLR_BIT(board->side_bitboards[BOTH], square);
 
-		board->middle_piece_square_score -= middle_piece_square_tables[piece][square];
-		board->end_piece_square_score -= end_piece_square_tables[piece][square];
+		board->piece_square_score -= piece_square_tables[piece][square];
 
 		if (piece == wP) //Update pawn material
 		{
@@ -332,8 +332,7 @@ void Remove_From_Piecelists(int piece, int square, BOARD_STRUCT *board)
 		CLR_BIT(board->side_bitboards[BLACK], square);
 		CLR_BIT(board->side_bitboards[BOTH], square);
 
-		board->middle_piece_square_score += middle_piece_square_tables[piece][square];
-		board->end_piece_square_score += end_piece_square_tables[piece][square];
+		board->piece_square_score += piece_square_tables[piece][square];
 
 		if (piece == bP) //Update pawn material
 		{
@@ -358,8 +357,7 @@ void Update_Piece_Lists(BOARD_STRUCT *board)
 	board->big_material[BLACK] = 0;
 	board->pawn_material[BLACK] = 0;
 
-	board->end_piece_square_score = 0;
-	board->middle_piece_square_score = 0;
+	board->piece_square_score = 0;
 
 	for (int i = 0; i <= bK; i++)
 	{
@@ -385,8 +383,7 @@ void Update_Piece_Lists(BOARD_STRUCT *board)
 					board->big_material[WHITE] += piece_values[piece];
 				}
 
-				board->middle_piece_square_score += middle_piece_square_tables[piece][index];
-				board->end_piece_square_score += end_piece_square_tables[piece][index];
+				board->piece_square_score += piece_square_tables[piece][index];
 			}
 			if (IS_BLACK_PIECE(piece))
 			{
@@ -399,8 +396,7 @@ void Update_Piece_Lists(BOARD_STRUCT *board)
 					board->big_material[BLACK] += piece_values[piece];
 				}
 
-				board->middle_piece_square_score -= middle_piece_square_tables[piece][index];
-				board->end_piece_square_score -= end_piece_square_tables[piece][index];
+				board->piece_square_score -= piece_square_tables[piece][index];
 			}
 		}
 	}
@@ -457,6 +453,25 @@ void Clear_Undo_List(BOARD_STRUCT *board)
 	board->undo_list.num = 0;
 }
 
+//Copies the position from one board to another for a search thread, along with the undo entries repetition checks read
+//Killers, history, pv and attack tables stay with the destination, they are most of the board's size
+void Copy_Position(BOARD_STRUCT *dest, BOARD_STRUCT *source)
+{
+	int first_undo = source->undo_list.num - source->move_counter - 1; //Repetition checks look back move_counter + 1 entries
+	if (first_undo < 0) first_undo = 0;
+
+	memcpy(dest, source, offsetof(BOARD_STRUCT, undo_list)); //Pieces, bitboards and state come first
+
+	memcpy(&dest->undo_list.list[first_undo], &source->undo_list.list[first_undo], (source->undo_list.num - first_undo) * sizeof(UNDO_STRUCT));
+	dest->undo_list.num = source->undo_list.num;
+
+	if (use_nnue) memcpy(dest->nn_accumulator, source->nn_accumulator, sizeof(source->nn_accumulator));
+
+	dest->hash_key = source->hash_key;
+	dest->pawn_hash_key = source->pawn_hash_key;
+	dest->age = source->age;
+}
+
 //Checks backwards in the undo list struct to see if the current position has occured three times
 int Is_Threefold_Repetition(BOARD_STRUCT *board)
 {
@@ -513,6 +528,9 @@ int Is_Repetition(BOARD_STRUCT *board)
 //Returns 1 if the board is a material draw
 int Is_Material_Draw(BOARD_STRUCT *board)
 {
+	//King and pawn against king is read from the bitbase
+	if (Is_KPK(board)) return !KPK_Probe(board);
+
 	//Not a draw if a pawn remains
 	if (board->pawn_material[WHITE] || board->pawn_material[BLACK]) return 0;
 
@@ -539,8 +557,7 @@ void Check_Board(BOARD_STRUCT *board)
 	int big_material_temp[2] = { 0 };
 	int pawn_material_temp[2] = { 0 };
 
-	int middle_piece_square_temp = 0;
-	int end_piece_square_temp = 0;
+	SCORE piece_square_temp = 0;
 
 	int piece_num_temp[13] = { 0 };
 	U64 hash_temp = 0;
@@ -567,8 +584,7 @@ void Check_Board(BOARD_STRUCT *board)
 			if (piece == wP) pawn_material_temp[WHITE] += piece_values[piece];
 			else if (piece != wK) big_material_temp[WHITE] += piece_values[piece];
 
-			middle_piece_square_temp += middle_piece_square_tables[piece][square];
-			end_piece_square_temp += end_piece_square_tables[piece][square];
+			piece_square_temp += piece_square_tables[piece][square];
 
 			SET_BIT(side_bitboards_temp[WHITE], square);
 		}
@@ -577,8 +593,7 @@ void Check_Board(BOARD_STRUCT *board)
 			if (piece == bP) pawn_material_temp[BLACK] += piece_values[piece];
 			else if (piece != bK) big_material_temp[BLACK] += piece_values[piece];
 
-			middle_piece_square_temp -= middle_piece_square_tables[piece][square];
-			end_piece_square_temp -= end_piece_square_tables[piece][square];
+			piece_square_temp -= piece_square_tables[piece][square];
 
 			SET_BIT(side_bitboards_temp[BLACK], square);
 		}		
@@ -603,8 +618,7 @@ void Check_Board(BOARD_STRUCT *board)
 
 
 	/***** Piece Square Score *****/
-	ASSERT(middle_piece_square_temp == board->middle_piece_square_score);
-	ASSERT(end_piece_square_temp == board->end_piece_square_score);
+	ASSERT(piece_square_temp == board->piece_square_score);
 
 	/***** Hashkey *****/
 	hash_temp = board->hash_key; //Store previous value
@@ -612,6 +626,31 @@ void Check_Board(BOARD_STRUCT *board)
 	Compute_Hash(board); //Recalculate hash
 	ASSERT(board->hash_key == hash_temp); //Make sure they match
 	ASSERT(board->pawn_hash_key == pawn_hash_temp);
+
+	/***** Network Accumulators *****/
+	if (use_nnue)
+	{
+		short accumulator_temp[2][NN_HIDDEN];
+		memcpy(accumulator_temp, board->nn_accumulator, sizeof(accumulator_temp));
+		NN_Refresh_Accumulator(board);
+		ASSERT(!memcmp(accumulator_temp, board->nn_accumulator, sizeof(accumulator_temp)));
+	}
+
+	/***** Attack Maps *****/
+	ATTACK_INFO_STRUCT *ai = &board->attack_info[min(board->hply, MAX_SEARCH_DEPTH)];
+	if (ai->hash == board->hash_key)
+	{
+		ATTACK_INFO_STRUCT ai_temp;
+		Compute_Attack_Info(&ai_temp, board);
+		ASSERT(!memcmp(&ai_temp, ai, sizeof(ai_temp)));
+
+		ASSERT((ai->checkers != 0) == In_Check(board->side, board));
+		for (int sq = 0; sq < 64; sq++)
+		{
+			ASSERT((GET_BIT(ai->side_attacks[WHITE], sq) != 0) == Under_Attack(sq, WHITE, board));
+			ASSERT((GET_BIT(ai->side_attacks[BLACK], sq) != 0) == Under_Attack(sq, BLACK, board));
+		}
+	}
 	
 	/***** Castling *****/
 
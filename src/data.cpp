@@ -53,6 +53,8 @@ int aspiration_windows[4] = { 20, INF, INF, INF };
 /***** Evaluation Arrays *****/
 int piece_values[13] = { 0, 100, 320, 330, 500, 900, 1000000, 100, 320, 330, 500, 900, 1000000 };
 int passed_pawn_rank_bonus[8] = { 0, 4, 9, 32, 41, 90, 117, 0 };
+int king_attack_weights[13] = { 0, 0, 2, 2, 3, 5, 0, 0, 2, 2, 3, 5, 0 }; //Attack units for each piece that reaches the enemy king zone
+int king_attack_unit_scores[KING_ATTACK_UNITS_MAX + 1] = { 0, 0, 4, 10, 18, 28, 40, 54, 70, 88, 108, 130, 154, 180, 208, 238, 270, 300, 330, 360, 390 }; //Grows faster than the units so combined attacks count for more
 
 //Contains the middle game piece square values for each piece
 short middle_piece_square_tables[13][64] = {
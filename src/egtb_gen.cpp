@@ -0,0 +1,583 @@
+/* egtb_gen.cpp
+* Contains the retrograde generator for small win/draw/loss endgame tables
+* Theo Kanning
+*/
+
+#include "globals.h"
+#include "stdio.h"
+#include "string.h"
+#include "stdlib.h"
+#include "windows.h"
+#include <thread>
+
+using namespace std;
+
+/* Tables are named like the Syzygy files, KRvKP has white king and rook against black king and pawn
+Positions are indexed by side to move, then the white king on files a-d, the black king and the other pieces in name order
+Identical pieces are stored on ascending squares, other orders and illegal positions are marked invalid
+Castling rights and en passant captures are not part of the tables
+
+File layout: "DZEG", version, piece count, the piece of each index slot padded to 4 bytes, 2 zero bytes,
+32 bit little endian position count, then 2 bits per position from the side to move's view, 4 positions per byte */
+
+#define GEN_MAX_PIECES		4 //Five pieces would need 2^31 positions
+#define GEN_MAX_TABLES		256 //Every table a 4 piece table can reach through captures and promotions
+#define GEN_CHUNK			4096 //Positions handed to a worker at a time
+#define GEN_HEADER_SIZE		16
+#define GEN_VERSION			1
+#define GEN_SUFFIX			".egt"
+
+enum GEN_RESULT_ENUM //Stored values
+{
+	GEN_DRAW = 0, GEN_WIN = 1, GEN_LOSS = 2, GEN_INVALID = 3
+};
+
+#define GEN_UNKNOWN			4 //Only used while generating
+#define GEN_NO_PASS			0xffff
+
+typedef struct
+{
+	char name[16];
+	int num; //Pieces including kings
+	int pieces[GEN_MAX_PIECES]; //Piece in each index slot, kings first
+	int counts[13];
+	U64 size; //Positions
+	unsigned char *data; //Packed results, points into the mapped file if one was loaded
+	HANDLE file;
+	HANDLE mapping;
+}GEN_TABLE_STRUCT;
+
+typedef struct
+{
+	GEN_TABLE_STRUCT *table;
+	std::atomic<unsigned char> *results;
+	std::atomic<unsigned char> *counters; //Moves that stay in the table and are not yet known to lose, plus one if a capture or promotion draws
+	std::atomic<unsigned short> *passes; //Pass that resolved each win or loss, set after the result so a position is never handled twice
+	int pass;
+	std::atomic<U64> next; //Next chunk to hand out
+	std::atomic<long> resolved; //Positions resolved in this pass
+}GEN_WORK_STRUCT;
+
+static GEN_TABLE_STRUCT *gen_tables[GEN_MAX_TABLES];
+static int gen_num_tables = 0;
+
+static const char gen_piece_chars[] = " PNBRQKPNBRQK";
+static const int gen_name_order[5] = { 5, 4, 3, 2, 1 }; //Queen to pawn, added to 6 for black
+
+/***** Indexing *****/
+
+//Mirrors the white king onto files a-d and sorts identical pieces, then returns the index
+static U64 Gen_Index(GEN_TABLE_STRUCT *table, int *sq, int side)
+{
+	U64 idx = 0;
+
+	if (GET_FILE(sq[0]) > FILE_D)
+	{
+		for (int i = 0; i < table->num; i++) sq[i] ^= 7;
+	}
+
+	for (int i = 2; i < table->num; i++)
+	{
+		for (int j = i; j > 2 && table->pieces[j] == table->pieces[j - 1] && sq[j] < sq[j - 1]; j--)
+		{
+			int temp = sq[j];
+			sq[j] = sq[j - 1];
+			sq[j - 1] = temp;
+		}
+	}
+
+	for (int i = table->num - 1; i >= 1; i--) idx = (idx << 6) | sq[i];
+	idx = (idx << 5) | (GET_RANK(sq[0]) << 2) | GET_FILE(sq[0]);
+	return (idx << 1) | side;
+}
+
+//Fills the squares and side of an index, returns 0 if it is not a stored position
+static int Gen_Decode(GEN_TABLE_STRUCT *table, U64 idx, int *sq, int *side)
+{
+	U64 occ = 0;
+
+	*side = (int)(idx & 1);
+	idx >>= 1;
+	sq[0] = (int)(((idx & 31) >> 2) * 8 + (idx & 3));
+	idx >>= 5;
+	for (int i = 1; i < table->num; i++)
+	{
+		sq[i] = (int)(idx & 63);
+		idx >>= 6;
+	}
+
+	for (int i = 0; i < table->num; i++)
+	{
+		if (GET_BIT(occ, sq[i])) return 0;
+		SET_BIT(occ, sq[i]);
+
+		if (IS_PAWN(table->pieces[i]) && (GET_RANK(sq[i]) == RANK_1 || GET_RANK(sq[i]) == RANK_8)) return 0;
+		if (i > 2 && table->pieces[i] == table->pieces[i - 1] && sq[i] < sq[i - 1]) return 0;
+	}
+
+	return !GET_BIT(king_attack_masks[sq[0]], sq[1]);
+}
+
+static inline int Gen_Read(const unsigned char *data, U64 idx)
+{
+	return (data[idx >> 2] >> (2 * (idx & 3))) & 3;
+}
+
+/***** Table List *****/
+
+static GEN_TABLE_STRUCT *Gen_Find_Table(const int counts[13])
+{
+	for (int i = 0; i < gen_num_tables; i++)
+	{
+		if (!memcmp(gen_tables[i]->counts, counts, sizeof(gen_tables[i]->counts))) return gen_tables[i];
+	}
+	return NULL;
+}
+
+//Fills the name, slots and size of a table from piece counts
+static void Gen_Setup_Table(GEN_TABLE_STRUCT *table, const int counts[13])
+{
+	int length = 0;
+
+	memcpy(table->counts, counts, sizeof(table->counts));
+	table->pieces[0] = wK;
+	table->pieces[1] = bK;
+	table->num = 2;
+
+	for (int side = WHITE; side <= BLACK; side++)
+	{
+		table->name[length++] = 'K';
+		for (int i = 0; i < 5; i++)
+		{
+			int piece = gen_name_order[i] + 6 * side;
+			for (int j = 0; j < counts[piece]; j++)
+			{
+				table->name[length++] = gen_piece_chars[piece];
+				table->pieces[table->num++] = piece;
+			}
+		}
+		if (side == WHITE) table->name[length++] = 'v';
+	}
+	table->name[length] = '\0';
+
+	table->size = 2ULL * 32;
+	for (int i = 1; i < table->num; i++) table->size *= 64;
+}
+
+//Returns the result for the side to move on a board, the table for its material must be finished
+static int Gen_Probe_Board(BOARD_STRUCT *board)
+{
+	int sq[GEN_MAX_PIECES];
+
+	if (board->big_material[WHITE] + board->big_material[BLACK] + board->pawn_material[WHITE] + board->pawn_material[BLACK] == 0) return GEN_DRAW;
+
+	GEN_TABLE_STRUCT *table = Gen_Find_Table(board->piece_num);
+	if (table == NULL || table->data == NULL) return GEN_INVALID;
+
+	for (int i = 0; i < table->num; i++)
+	{
+		if (i > 0 && table->pieces[i] == table->pieces[i - 1]) continue;
+		U64 temp = board->piece_bitboards[table->pieces[i]];
+		for (int j = i; temp; j++) sq[j] = pop_1st_bit(&temp);
+	}
+
+	return Gen_Read(table->data, Gen_Index(table, sq, board->side));
+}
+
+/***** Files *****/
+
+//Maps a table written earlier, returns 0 if there is none or it does not match
+static int Gen_Map_File(GEN_TABLE_STRUCT *table, const char *dir)
+{
+	char path[1024];
+
+	sprintf_s(path, "%s/%s%s", dir, table->name, GEN_SUFFIX);
+	HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, NULL);
+	if (file == INVALID_HANDLE_VALUE) return 0;
+
+	HANDLE mapping = CreateFileMapping(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	unsigned char *view = mapping ? (unsigned char *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+	if (view == NULL)
+	{
+		if (mapping) CloseHandle(mapping);
+		CloseHandle(file);
+		return 0;
+	}
+
+	int valid = !memcmp(view, "DZEG", 4) && view[4] == GEN_VERSION && view[5] == table->num;
+	for (int i = 0; i < table->num && valid; i++) valid = (view[6 + i] == table->pieces[i]);
+	if (!valid || (view[12] | (view[13] << 8) | (view[14] << 16) | ((U64)view[15] << 24)) != table->size)
+	{
+		printf("%s does not match, generating it again\n", path);
+		UnmapViewOfFile(view);
+		CloseHandle(mapping);
+		CloseHandle(file);
+		return 0;
+	}
+
+	table->file = file;
+	table->mapping = mapping;
+	table->data = view + GEN_HEADER_SIZE;
+	return 1;
+}
+
+static int Gen_Write_File(GEN_TABLE_STRUCT *table, const char *dir)
+{
+	char path[1024];
+	unsigned char header[GEN_HEADER_SIZE] = { 'D', 'Z', 'E', 'G', GEN_VERSION, (unsigned char)table->num };
+	FILE *out;
+
+	for (int i = 0; i < table->num; i++) header[6 + i] = (unsigned char)table->pieces[i];
+	for (int i = 0; i < 4; i++) header[12 + i] = (unsigned char)(table->size >> (8 * i));
+
+	sprintf_s(path, "%s/%s%s", dir, table->name, GEN_SUFFIX);
+	if (fopen_s(&out, path, "wb") != 0 || out == NULL)
+	{
+		printf("Could not open %s\n", path);
+		return 0;
+	}
+	fwrite(header, 1, GEN_HEADER_SIZE, out);
+	fwrite(table->data, 1, (size_t)(table->size / 4), out);
+	fclose(out);
+
+	return 1;
+}
+
+/***** Generation *****/
+
+static void Gen_Setup_Board(BOARD_STRUCT *board, GEN_TABLE_STRUCT *table, const int *sq, int side)
+{
+	for (int i = 0; i < 64; i++) board->board_array[i] = EMPTY;
+	for (int i = 0; i < table->num; i++) board->board_array[sq[i]] = table->pieces[i];
+
+	board->side = side;
+	board->castle_rights = 0;
+	board->ep = NO_SQUARE;
+	board->move_counter = 0;
+	board->hply = 0;
+	board->undo_list.num = 0;
+	Update_Piece_Lists(board);
+	Update_Bitboards(board);
+}
+
+//Classifies positions from their moves, captures and promotions are looked up in finished tables
+static void Gen_Init_Worker(GEN_WORK_STRUCT *work)
+{
+	GEN_TABLE_STRUCT *table = work->table;
+	BOARD_STRUCT *board = new BOARD_STRUCT;
+	MOVE_LIST_STRUCT move_list;
+	int sq[GEN_MAX_PIECES];
+	int side;
+	U64 start;
+
+	memset(board, 0, sizeof(BOARD_STRUCT));
+
+	while ((start = work->next.fetch_add(GEN_CHUNK)) < table->size)
+	{
+		for (U64 idx = start; idx < min(start + GEN_CHUNK, table->size); idx++)
+		{
+			work->passes[idx] = GEN_NO_PASS;
+			work->counters[idx] = 0;
+
+			if (!Gen_Decode(table, idx, sq, &side))
+			{
+				work->results[idx] = GEN_INVALID;
+				continue;
+			}
+
+			Gen_Setup_Board(board, table, sq, side);
+			if (In_Check(side ^ 1, board))
+			{
+				work->results[idx] = GEN_INVALID;
+				continue;
+			}
+
+			int legal = 0, win = 0, draw = 0, stay = 0;
+			Generate_Moves(board, &move_list);
+			for (int i = 0; i < move_list.num && !win; i++)
+			{
+				int move = move_list.list[i].move;
+				if (!Make_Move(move, board)) continue;
+				legal++;
+
+				if (IS_CAPTURE(move) || IS_PROMOTION(move))
+				{
+					int result = Gen_Probe_Board(board);
+					if (result == GEN_LOSS) win = 1;
+					else if (result == GEN_DRAW) draw = 1;
+				}
+				else stay++;
+
+				Take_Move(board);
+			}
+
+			int result = GEN_UNKNOWN;
+			if (win) result = GEN_WIN;
+			else if (!legal) result = In_Check(side, board) ? GEN_LOSS : GEN_DRAW;
+			else if (!stay && !draw) result = GEN_LOSS;
+			else work->counters[idx] = (unsigned char)(stay + draw);
+
+			work->results[idx] = (unsigned char)result;
+			if (result == GEN_WIN || result == GEN_LOSS) work->passes[idx] = 0;
+		}
+	}
+
+	delete board;
+}
+
+//Unmakes every quiet move into a position resolved in the last pass
+//A loss makes the position before it a win, and a position is lost once every move from it reaches a win
+static void Gen_Retro_Worker(GEN_WORK_STRUCT *work)
+{
+	GEN_TABLE_STRUCT *table = work->table;
+	int sq[GEN_MAX_PIECES], prev[GEN_MAX_PIECES];
+	int side;
+	U64 start;
+
+	while ((start = work->next.fetch_add(GEN_CHUNK)) < table->size)
+	{
+		for (U64 idx = start; idx < min(start + GEN_CHUNK, table->size); idx++)
+		{
+			int result = work->results[idx];
+			if ((result != GEN_WIN && result != GEN_LOSS) || work->passes[idx] != work->pass) continue;
+
+			Gen_Decode(table, idx, sq, &side);
+			const int mover = side ^ 1;
+			U64 occ = 0;
+			for (int i = 0; i < table->num; i++) SET_BIT(occ, sq[i]);
+
+			for (int i = 0; i < table->num; i++)
+			{
+				const int piece = table->pieces[i];
+				const int to = sq[i];
+				U64 from_squares = 0;
+
+				if (IS_BLACK_PIECE(piece) != (mover == BLACK)) continue;
+
+				switch (piece)
+				{
+				case wK: case bK: from_squares = king_attack_masks[to]; break;
+				case wN: case bN: from_squares = knight_attack_masks[to]; break;
+				case wB: case bB: from_squares = Bishop_Attacks(occ, to); break;
+				case wR: case bR: from_squares = Rook_Attacks(occ, to); break;
+				case wQ: case bQ: from_squares = Bishop_Attacks(occ, to) | Rook_Attacks(occ, to); break;
+				case wP:
+					if (GET_RANK(to) >= RANK_3 && !GET_BIT(occ, (to - 8)))
+					{
+						SET_BIT(from_squares, (to - 8));
+						if (GET_RANK(to) == RANK_4 && !GET_BIT(occ, (to - 16))) SET_BIT(from_squares, (to - 16));
+					}
+					break;
+				case bP:
+					if (GET_RANK(to) <= RANK_6 && !GET_BIT(occ, (to + 8)))
+					{
+						SET_BIT(from_squares, (to + 8));
+						if (GET_RANK(to) == RANK_5 && !GET_BIT(occ, (to + 16))) SET_BIT(from_squares, (to + 16));
+					}
+					break;
+				}
+				from_squares &= ~occ;
+
+				while (from_squares)
+				{
+					memcpy(prev, sq, sizeof(prev));
+					prev[i] = pop_1st_bit(&from_squares);
+					U64 prev_idx = Gen_Index(table, prev, mover);
+					unsigned char expected = GEN_UNKNOWN;
+
+					if (work->results[prev_idx] != GEN_UNKNOWN) continue;
+
+					if (result == GEN_LOSS)
+					{
+						if (work->results[prev_idx].compare_exchange_strong(expected, GEN_WIN))
+						{
+							work->passes[prev_idx] = (unsigned short)(work->pass + 1);
+							work->resolved++;
+						}
+					}
+					else if (--work->counters[prev_idx] == 0)
+					{
+						if (work->results[prev_idx].compare_exchange_strong(expected, GEN_LOSS))
+						{
+							work->passes[prev_idx] = (unsigned short)(work->pass + 1);
+							work->resolved++;
+						}
+					}
+				}
+			}
+		}
+	}
+}
+
+//Runs one kind of worker on every thread until all positions are handed out
+static void Gen_Run_Workers(void (*worker)(GEN_WORK_STRUCT *), GEN_WORK_STRUCT *work, int threads)
+{
+	std::thread workers[MAX_THREADS];
+
+	work->next = 0;
+	for (int i = 0; i < threads; i++) workers[i] = std::thread(worker, work);
+	for (int i = 0; i < threads; i++) workers[i].join();
+}
+
+static void Gen_Solve_Table(GEN_TABLE_STRUCT *table, int threads)
+{
+	GEN_WORK_STRUCT work;
+	long totals[4] = { 0 };
+	int start_time = Get_Time_Ms();
+
+	printf("Generating %s, %llu positions\n", table->name, table->size);
+
+	work.table = table;
+	work.results = new std::atomic<unsigned char>[table->size];
+	work.counters = new std::atomic<unsigned char>[table->size];
+	work.passes = new std::atomic<unsigned short>[table->size];
+
+	Gen_Run_Workers(Gen_Init_Worker, &work, threads);
+
+	for (work.pass = 0; ; work.pass++)
+	{
+		work.resolved = 0;
+		Gen_Run_Workers(Gen_Retro_Worker, &work, threads);
+		if (work.resolved == 0) break;
+	}
+
+	//Anything still unknown can avoid losing forever
+	table->data = new unsigned char[table->size / 4];
+	memset(table->data, 0, (size_t)(table->size / 4));
+	for (U64 idx = 0; idx < table->size; idx++)
+	{
+		int result = work.results[idx];
+		if (result == GEN_UNKNOWN) result = GEN_DRAW;
+
+		table->data[idx >> 2] |= result << (2 * (idx & 3));
+		totals[result]++;
+	}
+
+	printf("%s: wins %ld draws %ld losses %ld, longest result %d plies, time %d ms\n",
+		table->name, totals[GEN_WIN], totals[GEN_DRAW], totals[GEN_LOSS], work.pass, Get_Time_Ms() - start_time);
+
+	delete[] work.results;
+	delete[] work.counters;
+	delete[] work.passes;
+}
+
+//Makes every table reachable from counts, loading earlier files from dir and writing new ones there
+//Returns NULL for bare kings, which are always drawn
+static GEN_TABLE_STRUCT *Gen_Build_Table(const int counts[13], const char *dir, int threads)
+{
+	int sub_counts[13];
+	GEN_TABLE_STRUCT *table = Gen_Find_Table(counts);
+
+	if (table || counts[wP] + counts[wN] + counts[wB] + counts[wR] + counts[wQ] + counts[bP] + counts[bN] + counts[bB] + counts[bR] + counts[bQ] == 0) return table;
+
+	for (int piece = wP; piece <= bQ; piece++)
+	{
+		if (IS_KING(piece) || counts[piece] == 0) continue;
+
+		memcpy(sub_counts, counts, sizeof(sub_counts));
+		sub_counts[piece]--;
+		Gen_Build_Table(sub_counts, dir, threads); //Capture
+
+		if (IS_PAWN(piece))
+		{
+			for (int promoted = piece + 1; promoted <= piece + 4; promoted++)
+			{
+				sub_counts[promoted]++;
+				Gen_Build_Table(sub_counts, dir, threads);
+				sub_counts[promoted]--;
+			}
+		}
+	}
+
+	table = new GEN_TABLE_STRUCT;
+	memset(table, 0, sizeof(GEN_TABLE_STRUCT));
+	Gen_Setup_Table(table, counts);
+	gen_tables[gen_num_tables++] = table;
+
+	if (Gen_Map_File(table, dir)) printf("Loaded %s\n", table->name);
+	else
+	{
+		Gen_Solve_Table(table, threads);
+		Gen_Write_File(table, dir);
+	}
+
+	return table;
+}
+
+static void Gen_Free_Tables(void)
+{
+	for (int i = 0; i < gen_num_tables; i++)
+	{
+		GEN_TABLE_STRUCT *table = gen_tables[i];
+
+		if (table->mapping)
+		{
+			UnmapViewOfFile(table->data - GEN_HEADER_SIZE);
+			CloseHandle(table->mapping);
+			CloseHandle(table->file);
+		}
+		else delete[] table->data;
+		delete table;
+	}
+	gen_num_tables = 0;
+}
+
+//Generates a table and every smaller one it needs
+//Command is "egtb_gen <material> [dir] [threads n]", material is like KRvKP with up to 4 pieces
+//Tables already in dir are mapped instead of generated, dir is the current directory if not given
+void EGTB_Generate(char *line)
+{
+	char args[5][256];
+	int num_args = 0, threads = 0;
+	const char *dir = ".";
+	int counts[13] = { 0 };
+	int side = WHITE, kings = 0, pieces = 0;
+
+	while (num_args < 5)
+	{
+		while (*line == ' ' || *line == '\t') line++;
+		if (*line == '\0') break;
+		int length = (int)strcspn(line, " \t");
+		memcpy(args[num_args], line, min(length, 255));
+		args[num_args][min(length, 255)] = '\0';
+		line += length;
+		num_args++;
+	}
+
+	for (int i = 2; i < num_args; i++)
+	{
+		if (!strcmp(args[i], "threads") && i + 1 < num_args) threads = atoi(args[++i]);
+		else dir = args[i];
+	}
+
+	//Material, each side starts with its king
+	for (char *c = (num_args > 1) ? args[1] : (char *)""; *c; c++)
+	{
+		static const char letters[] = "PNBRQK";
+		const char *found = strchr(letters, *c);
+
+		if (*c == 'v' && side == WHITE) side = BLACK;
+		else if (found)
+		{
+			int piece = (int)(found - letters) + 1 + 6 * side;
+			counts[piece]++;
+			if (IS_KING(piece)) kings++;
+			pieces++;
+		}
+		else pieces = GEN_MAX_PIECES + 1;
+	}
+	if (num_args < 2 || side != BLACK || kings != 2 || counts[wK] != 1 || pieces < 3 || pieces > GEN_MAX_PIECES)
+	{
+		printf("Usage: egtb_gen <material like KRvK, 3 or 4 pieces> [dir] [threads n]\n");
+		return;
+	}
+
+	if (threads <= 0) threads = (int)std::thread::hardware_concurrency();
+	threads = max(1, min(threads, MAX_THREADS));
+
+	int start_time = Get_Time_Ms();
+	Gen_Build_Table(counts, dir, threads);
+	printf("Tables done, %d tables, time %d ms\n", gen_num_tables, Get_Time_Ms() - start_time);
+
+	Gen_Free_Tables();
+}
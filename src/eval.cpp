@@ -3,6 +3,9 @@
 * Theo Kanning 12/5/14
 */
 #include "globals.h"
+#include "windows.h"
+
+using namespace std;
 
 #define ENDGAME_MATERIAL		2000
 #define START_MATERIAL			8000
@@ -18,13 +21,26 @@
 #define KNIGHT_PAIR			   -10	//Penalty in cp for having knight pair
 #define ROOK_PAIR			   -10	//Penalty in cp for having rook pair
 
+#define MOBILITY_SCORE			2	//Score for each safe square reached by a minor or major piece
+#define PAWN_THREAT_PENALTY	   -25	//Penalty for each piece attacked by an enemy pawn
+#define HANGING_PIECE_PENALTY  -15	//Penalty for each piece attacked and not defended
+#define KING_ATTACK_MIN_PIECES	2	//Pieces that must reach the enemy king zone before attack units are scored
+
+//Packed middle and end game piece square tables, built from the two short tables in data
+SCORE piece_square_tables[13][64];
+
 //Pawn evaluation masks
 U64 white_passed_masks[64];
 U64 black_passed_masks[64];
 U64 isolated_masks[64];
 U64 doubled_masks[64];
 
-int Evaluate_Board(BOARD_STRUCT *board)
+//King shield masks, the three second rank squares in front of a castled king and the three squares one rank further
+U64 shield_masks[2][64];
+U64 far_shield_masks[2][64];
+
+//Returns the material, piece square and pair bonus score from white's side, the terms that are updated with the board
+static int Get_Fast_Eval_Score(BOARD_STRUCT *board)
 {
 	int score = 0;
 	int total_big_material = board->big_material[BLACK] + board->big_material[BLACK];
@@ -36,8 +52,8 @@ int Evaluate_Board(BOARD_STRUCT *board)
 	int material_score = material_diff;// +(material_diff * winning_pawn_num * (START_MATERIAL - total_material)) / (START_BIG_MATERIAL * (winning_pawn_num + 1));
 	score += material_score;
 
-	/* Piece square table score */
-	score += (total_big_material * board->middle_piece_square_score + (START_BIG_MATERIAL - total_big_material) * board->end_piece_square_score) / START_BIG_MATERIAL;
+	/* Phased terms are summed as packed scores */
+	SCORE phased_score = board->piece_square_score;
 
 	/* Pair bonuses */
 	if (board->piece_num[wB] >= 2) score += BISHOP_PAIR;
@@ -49,9 +65,50 @@ int Evaluate_Board(BOARD_STRUCT *board)
 	if (board->piece_num[wR] >= 2) score += ROOK_PAIR;
 	if (board->piece_num[bR] >= 2) score -= ROOK_PAIR;
 
+	/* Tapered blend of the phased terms, done once */
+	score += (total_big_material * MG_SCORE(phased_score) + (START_BIG_MATERIAL - total_big_material) * EG_SCORE(phased_score)) / START_BIG_MATERIAL;
+
+	return score;
+}
+
+//Returns the mobility, threat and king attack score from white's side, read from the position's attack maps
+static int Get_Attack_Score(BOARD_STRUCT *board)
+{
+	ATTACK_INFO_STRUCT *ai = Get_Attack_Info(board);
+	int score = 0;
+
+	for (int side = WHITE; side <= BLACK; side++)
+	{
+		int side_score = 0;
+		const int enemy = side ^ 1;
+		const U64 pieces = board->side_bitboards[side] & ~board->piece_bitboards[side == WHITE ? wP : bP] & ~board->piece_bitboards[side == WHITE ? wK : bK];
+
+		side_score += ai->mobility[side] * MOBILITY_SCORE;
+		side_score += count_1s(pieces & ai->piece_attacks[enemy == WHITE ? wP : bP]) * PAWN_THREAT_PENALTY;
+		side_score += count_1s(pieces & ai->side_attacks[enemy] & ~ai->side_attacks[side]) * HANGING_PIECE_PENALTY;
+		if (ai->king_zone_attackers[enemy] >= KING_ATTACK_MIN_PIECES) side_score += king_attack_unit_scores[min(ai->king_attack_units[enemy], KING_ATTACK_UNITS_MAX)];
+
+		score += (side == WHITE) ? side_score : -side_score;
+	}
+
+	return score;
+}
+
+int Evaluate_Board(BOARD_STRUCT *board)
+{
+	/* King and pawn against king is exact */
+	if (Is_KPK(board)) return KPK_Evaluate(board);
+
+	if (use_nnue) return NN_Evaluate(board);
+
+	int score = Get_Fast_Eval_Score(board);
+
 	/* Pawn structure score */
 	score += Get_Pawn_And_King_Score(board);
 
+	/* Mobility and threats */
+	if (use_attack_eval) score += Get_Attack_Score(board);
+
 	/* Low material correction 
 	* Divide score in cases of drawish endings (add later) 
 	*/
@@ -70,9 +127,107 @@ int Evaluate_Board(BOARD_STRUCT *board)
 	}
 }
 
+//Returns an evaluation for the side to move when only its position relative to [alpha, beta] matters
+//If the fast terms are further than lazy_eval_margin outside the window, the pawn, king and attack terms cannot bring it back, so they are skipped
+//and the fast score moved by the margin is returned, a bound on the full evaluation that is still outside the window
+//is_bound is set to 1 in that case and 0 when the full evaluation is returned
+int Lazy_Evaluate(int alpha, int beta, BOARD_STRUCT *board, int *is_bound)
+{
+	*is_bound = 0;
+	if (use_nnue || !use_lazy_eval || Is_KPK(board)) return Evaluate_Board(board);
+
+	int score = Get_Fast_Eval_Score(board);
+	int side_score = (board->side == WHITE) ? score : -score;
+
+	*is_bound = 1;
+	if (side_score - lazy_eval_margin >= beta) return side_score - lazy_eval_margin; //Lower bound
+	if (side_score + lazy_eval_margin <= alpha) return side_score + lazy_eval_margin; //Upper bound
+	*is_bound = 0;
+
+	score += Get_Pawn_And_King_Score(board);
+	if (use_attack_eval) score += Get_Attack_Score(board);
+	board->eval_score = score;
+
+	return (board->side == WHITE) ? score : -score;
+}
+
+
+/***** Pawn Structure *****/
+/* Pawn terms are found for all pawns at once with shifts and fills, then counted */
+
+//Spreads each set bit toward rank 8, keeping the starting squares
+static inline U64 North_Fill(U64 b)
+{
+	b |= b << 8;
+	b |= b << 16;
+	b |= b << 32;
+	return b;
+}
+
+//Spreads each set bit toward rank 1, keeping the starting squares
+static inline U64 South_Fill(U64 b)
+{
+	b |= b >> 8;
+	b |= b >> 16;
+	b |= b >> 32;
+	return b;
+}
+
+//Returns the squares one file to either side of each set bit
+static inline U64 Adjacent_Files(U64 b)
+{
+	return ((b << 1) & ~file_masks[FILE_A]) | ((b >> 1) & ~file_masks[FILE_H]);
+}
 
 //Returns pawn evaluation score
 int Get_Pawn_Eval_Score(BOARD_STRUCT *board)
+{
+	int score = 0;
+	const U64 white_pawns = board->piece_bitboards[wP];
+	const U64 black_pawns = board->piece_bitboards[bP];
+
+	//Squares in front of and behind each side's pawns, not including the pawns
+	const U64 white_front_span = North_Fill(white_pawns << 8);
+	const U64 white_rear_span = South_Fill(white_pawns >> 8);
+	const U64 black_front_span = South_Fill(black_pawns >> 8);
+	const U64 black_rear_span = North_Fill(black_pawns << 8);
+
+	//Passed pawns have no enemy pawn ahead on their own or a neighboring file
+	const U64 white_passed = white_pawns & ~(black_front_span | Adjacent_Files(black_front_span));
+	const U64 black_passed = black_pawns & ~(white_front_span | Adjacent_Files(white_front_span));
+
+	//Doubled pawns have a pawn of their color ahead or behind, each pawn of the pair is counted
+	const U64 white_doubled = white_pawns & (white_front_span | white_rear_span);
+	const U64 black_doubled = black_pawns & (black_front_span | black_rear_span);
+
+	//Isolated pawns have no other pawn of their color on their own or a neighboring file
+	const U64 white_isolated = white_pawns & ~white_doubled & ~Adjacent_Files(white_front_span | white_pawns | white_rear_span);
+	const U64 black_isolated = black_pawns & ~black_doubled & ~Adjacent_Files(black_front_span | black_pawns | black_rear_span);
+
+	score += (count_1s(white_isolated) - count_1s(black_isolated)) * ISOLATED_PAWN_PENALTY;
+	score += (count_1s(white_doubled) - count_1s(black_doubled)) * DOUBLED_PAWN_PENALTY;
+
+	//Passed pawns by rank, bonuses are from each side's own view
+	if (white_passed | black_passed)
+	{
+		for (int rank = RANK_2; rank <= RANK_7; rank++)
+		{
+			score += count_1s(white_passed & rank_masks[rank]) * passed_pawn_rank_bonus[rank];
+			score -= count_1s(black_passed & rank_masks[rank]) * passed_pawn_rank_bonus[RANK_8 - rank];
+		}
+
+		//Passed pawns next to their own king
+		U64 temp = board->piece_bitboards[wK];
+		score += count_1s(white_passed & king_attack_masks[pop_1st_bit(&temp)]) * PROTECTED_PASSER_SCORE;
+		temp = board->piece_bitboards[bK];
+		score -= count_1s(black_passed & king_attack_masks[pop_1st_bit(&temp)]) * PROTECTED_PASSER_SCORE;
+	}
+
+	return score;
+}
+
+//Returns pawn evaluation score one pawn at a time, kept as the reference for pawn_test
+int Get_Pawn_Eval_Score_Per_Pawn(BOARD_STRUCT *board)
 {
 	int sq64;
 	int score = 0;
@@ -129,6 +284,18 @@ int Get_Pawn_Eval_Score(BOARD_STRUCT *board)
 	return score;
 }
 
+//Packs the middle and end game piece square tables, called again whenever tuning changes them
+void Init_Piece_Square_Tables(void)
+{
+	for (int piece = 0; piece < 13; piece++)
+	{
+		for (int square = 0; square < 64; square++)
+		{
+			piece_square_tables[piece][square] = MAKE_SCORE(middle_piece_square_tables[piece][square], end_piece_square_tables[piece][square]);
+		}
+	}
+}
+
 //Initializes pawn eval masks
 void Init_Pawn_Masks(void)
 {
@@ -181,72 +348,53 @@ void Init_Pawn_Masks(void)
 				}
 			}
 		}
+
+		//King shield masks, only for kings castled on either wing
+		shield_masks[WHITE][index] = 0;
+		far_shield_masks[WHITE][index] = 0;
+		shield_masks[BLACK][index] = 0;
+		far_shield_masks[BLACK][index] = 0;
+
+		U64 wing = 0;
+		if (file > FILE_E) wing = file_masks[FILE_F] | file_masks[FILE_G] | file_masks[FILE_H];
+		else if (file < FILE_D) wing = file_masks[FILE_A] | file_masks[FILE_B] | file_masks[FILE_C];
+
+		if (rank == RANK_1)
+		{
+			shield_masks[WHITE][index] = wing & rank_masks[RANK_2];
+			far_shield_masks[WHITE][index] = wing & rank_masks[RANK_3];
+		}
+		else if (rank == RANK_8)
+		{
+			shield_masks[BLACK][index] = wing & rank_masks[RANK_7];
+			far_shield_masks[BLACK][index] = wing & rank_masks[RANK_6];
+		}
 	}
 
 }
 
 //Looks at pawn shielding around each king and returns white - black score
+//A shield pawn one rank further forward counts half, king position is part of the pawn hash key so this is cached with the pawn score
 int Get_King_Safety_Score(BOARD_STRUCT *board)
 {
-	int white_score = 0;
-	int black_score = 0;
+	const U64 white_pawns = board->piece_bitboards[wP];
+	const U64 black_pawns = board->piece_bitboards[bP];
 
 	U64 temp = board->piece_bitboards[wK];
 	int white_king_square = pop_1st_bit(&temp);
 	temp = board->piece_bitboards[bK];
 	int black_king_square = pop_1st_bit(&temp);
 
-	//White king on kingside
-	if (GET_FILE(white_king_square) > FILE_E && GET_RANK(white_king_square) == RANK_1) {
-
-		if (board->board_array[F2] == wP)  white_score += PAWN_SHIELD_SCORE;
-		else if (board->board_array[F3] == wP)  white_score += PAWN_SHIELD_SCORE / 2;
-
-		if (board->board_array[G2] == wP)  white_score += PAWN_SHIELD_SCORE;
-		else if (board->board_array[G3] == wP)  white_score += PAWN_SHIELD_SCORE / 2;
-
-		if (board->board_array[H2] == wP)  white_score += PAWN_SHIELD_SCORE;
-		else if (board->board_array[H3] == wP)  white_score += PAWN_SHIELD_SCORE / 2;
-	}
-	else if (GET_FILE(white_king_square) < FILE_D && GET_RANK(white_king_square) == RANK_1) {
-
-		if (board->board_array[A2] == wP)  white_score += PAWN_SHIELD_SCORE;
-		else if (board->board_array[A3] == wP)  white_score += PAWN_SHIELD_SCORE / 2;
+	//Far shield pawns only count on files without a near one
+	U64 white_near = white_pawns & shield_masks[WHITE][white_king_square];
+	U64 white_far = white_pawns & far_shield_masks[WHITE][white_king_square] & ~(white_near << 8);
+	U64 black_near = black_pawns & shield_masks[BLACK][black_king_square];
+	U64 black_far = black_pawns & far_shield_masks[BLACK][black_king_square] & ~(black_near >> 8);
 
-		if (board->board_array[B2] == wP)  white_score += PAWN_SHIELD_SCORE;
-		else if (board->board_array[B3] == wP)  white_score += PAWN_SHIELD_SCORE / 2;
-
-		if (board->board_array[C2] == wP)  white_score += PAWN_SHIELD_SCORE;
-		else if (board->board_array[C3] == wP)  white_score += PAWN_SHIELD_SCORE / 2;
-	}
-	
-
-	//Black king on kingside
-	if (GET_FILE(black_king_square) > FILE_E && GET_RANK(black_king_square) == RANK_8) {
-
-		if (board->board_array[F7] == bP)  black_score += PAWN_SHIELD_SCORE;
-		else if (board->board_array[F6] == bP)  black_score += PAWN_SHIELD_SCORE / 2;
-
-		if (board->board_array[G7] == bP)  black_score += PAWN_SHIELD_SCORE;
-		else if (board->board_array[G6] == bP)  black_score += PAWN_SHIELD_SCORE / 2;
-
-		if (board->board_array[H7] == bP)  black_score += PAWN_SHIELD_SCORE;
-		else if (board->board_array[H6] == bP)  black_score += PAWN_SHIELD_SCORE / 2;
-	}
-	else if (GET_FILE(black_king_square) < FILE_D && GET_RANK(black_king_square) == RANK_8) {
-
-		if (board->board_array[A7] == bP)  black_score += PAWN_SHIELD_SCORE;
-		else if (board->board_array[A6] == bP)  black_score += PAWN_SHIELD_SCORE / 2;
-
-		if (board->board_array[B7] == bP)  black_score += PAWN_SHIELD_SCORE;
-		else if (board->board_array[B6] == bP)  black_score += PAWN_SHIELD_SCORE / 2;
-
-		if (board->board_array[C7] == bP)  black_score += PAWN_SHIELD_SCORE;
-		else if (board->board_array[C6] == bP)  black_score += PAWN_SHIELD_SCORE / 2;
-	}
+	int white_score = count_1s(white_near) * PAWN_SHIELD_SCORE + count_1s(white_far) * (PAWN_SHIELD_SCORE / 2);
+	int black_score = count_1s(black_near) * PAWN_SHIELD_SCORE + count_1s(black_far) * (PAWN_SHIELD_SCORE / 2);
 
 	return white_score - black_score;
-
 }
 
 //Returns evaluation for pawns and kings, checks hash table for hit
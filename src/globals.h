@@ -4,6 +4,8 @@
 */
 #include "math.h"
 #include <iostream>
+#include <atomic>
+#include <mutex>
 #include "move_macros.h"
 
 /***** Global Macros *****/
@@ -42,6 +44,8 @@
 #define MATE_SCORE					15000
 #define IS_MATE(x)					(abs(x) >= MATE_SCORE - MAX_SEARCH_DEPTH && abs(x) <= MATE_SCORE)
 #define ADJUST_MATE_SCORE(score,ply)		((score < 0) ? -MATE_SCORE + ply : MATE_SCORE -ply)
+#define TB_WIN_SCORE				(MATE_SCORE - 2 * MAX_SEARCH_DEPTH) //Tablebase wins, below every mate score
+#define IS_PLY_SCORE(x)				(abs(x) >= TB_WIN_SCORE - MAX_SEARCH_DEPTH && abs(x) <= MATE_SCORE) //Mate and tablebase scores, which count from the root
 
 #define START_FEN		"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"
 
@@ -65,15 +69,38 @@
 #define IS_QUEEN(x)					(is_queen[x]) //((x == wQ) || (x == bQ))
 #define IS_KING(x)					(is_king[x]) //((x == wK) || (x == bK))
 
+//Packed scores, the end game value sits in the high 16 bits and the middle game value in the low 16 bits
+//Adding or subtracting packed scores updates both phases at once, values must stay within 16 bits
+#define MAKE_SCORE(mg,eg)			((SCORE)((unsigned int)(eg) << 16) + (mg))
+#define MG_SCORE(s)					((short)(unsigned short)(unsigned int)(s))
+#define EG_SCORE(s)					((short)(unsigned short)((unsigned int)((s) + 0x8000) >> 16))
+
 //Late move reduction macros
 #define CAN_REDUCE(move)			(!IS_CAPTURE(move) && !IS_PROMOTION(move)) //Returns 1 if move is not a promotion or capture
 #define REDUCTION_LIMIT				3 //Minimum depth to consider reductions
 #define LATE_MOVE_NUM				2 //First move number to consider reducing
 #define LATE_MOVE_REDUCTION			1 //Number of ply to shorten late move searches
 
+//Parallel search macros
+#define MAX_THREADS					64 //Search threads including the main thread
+#define MAX_SPLIT_POINTS			8 //Nested split points owned by one thread
+#define SPLIT_MIN_DEPTH				4 //Minimum remaining depth to share a node with helpers
+#define SEARCH_ABORTED(info)		((info)->stopped || ((info)->split_point && Split_Aborted((info)->split_point))) //Stopped or a split point above found a cutoff
+
+//King safety
+#define KING_ATTACK_UNITS_MAX		20 //Attack units past this score the same
+
+//Neural network evaluation
+#define NN_HIDDEN					256 //Accumulator size for each side
+
+//Uci output
+#define CURRMOVE_TIME				3000 //Ms before root moves are reported with info currmove
+
 
 /***** Global structures and typedefs *****/
 typedef unsigned long long U64; //64 bit integer
+typedef unsigned short U16; //16 bit integer, used for compact moves
+typedef int SCORE; //Packed middle and end game score, see MAKE_SCORE
 
 enum PIECE_NAME_ENUM
 {
@@ -115,7 +142,7 @@ enum CASTLE_ENUM
 
 enum PV_ENUM
 {
-	NOT_PV, PV
+	NOT_PV, PV, ROOT //Root is a pv node at ply 0
 };
 
 enum NULL_ENUM
@@ -123,6 +150,16 @@ enum NULL_ENUM
 	DONT_DO_NULL, DO_NULL
 };
 
+enum IID_ENUM //What to do in a pv node without a hash move
+{
+	IID_SWEEP, IID_SHALLOW, IID_REDUCTION
+};
+
+enum SMP_ENUM //How helper threads share the search
+{
+	SMP_SHARED_HASH, SMP_YBW //Independent searches through the hash table, or young brothers wait split points
+};
+
 typedef struct
 {
 	int move; //32 bit move stores all necessary data 
@@ -135,6 +172,21 @@ typedef struct
 	int num;
 }MOVE_LIST_STRUCT;
 
+typedef struct
+{
+	int move;
+	int order_score; //Score from move generation
+	int score; //Score from the latest root search, -INF unless the move raised alpha
+	int prev_score; //Score from the root search before that
+	long nodes; //Nodes searched under this move in the latest root search
+}ROOT_MOVE_STRUCT;
+
+typedef struct
+{
+	ROOT_MOVE_STRUCT list[MAX_MOVE_LIST_LENGTH];
+	int num;
+}ROOT_MOVE_LIST_STRUCT;
+
 typedef struct
 {
 	int move_counter;
@@ -161,36 +213,60 @@ typedef struct
 typedef struct
 {
 	int start_time;
-	int stop_time;
+	int stop_time; //Hard limit, search is stopped here
+	int soft_stop_time; //Optimum time, new iterations are not started after this
 	int time_set;
 	int end_early; //Enable ending early if using normal clock
-	int stopped;
+	std::atomic<int> stopped; //Set on timeout or by the input thread
 	long nodes;
+	long total_nodes; //Nodes from previous iterations
+	long node_limit; //Stop when total nodes reach this, 0 for no limit
 
 	int depth;
 	int max_depth; //Max depth reached in normal search
 
 	int age; //Number of irreversible moves made
+	int use_hash; //Quiescent search probes and stores hash entries, cleared for eval_batch
 	long hash_probes;
 	long hash_hits;
 	long pawn_hash_probes;
 	long pawn_hash_hits;
 
+	long qs_nodes;
+	long tb_hits; //Tablebase probes that found the position
+	long delta_pruned; //Captures skipped by delta pruning
+	long see_pruned; //Captures skipped by SEE pruning
+
+	ROOT_MOVE_LIST_STRUCT root_moves; //Legal root moves, kept in order across iterations
+	int pv_index; //Multipv line being searched, root moves before this index are skipped
+
 	int best_index[MAX_MOVE_LIST_LENGTH];
 	int beta_cutoff_index[MAX_MOVE_LIST_LENGTH];
 
-	int quit;
+	std::atomic<int> quit;
+	std::atomic<int> ponderhit; //Set by the input thread when the gui sends ponderhit
+	int pondering; //Searching the expected reply on the opponent's time, cleared by the search on ponderhit
+
+	int thread_index; //0 for the main search thread, helpers count up from 1
+	struct SPLIT_POINT_STRUCT *split_point; //Innermost split point this thread is searching under, NULL if none
 	
 }SEARCH_INFO_STRUCT;
 
 typedef struct
 {
-	U64 hash;
-	int depth;
-	int flag;
-	int eval;
-	int age; //number of irreversible moves made
-	int move;
+	U64 hash; //Stored xored with data so an entry torn by another thread fails the key check
+	union
+	{
+		struct
+		{
+			short eval;
+			U16 move; //Compact move
+			short age; //number of irreversible moves made
+			char depth;
+			char flag;
+		};
+		U64 data; //All fields as one word, read and written in a single access
+	};
 }HASH_ENTRY_STRUCT;
 
 typedef struct
@@ -199,6 +275,19 @@ typedef struct
 	HASH_ENTRY_STRUCT *table;
 }HASH_TABLE_STRUCT;
 
+typedef struct
+{
+	U64 hash; //Position the maps were computed for
+	U64 piece_attacks[13]; //Squares attacked by each piece type
+	U64 side_attacks[2]; //Squares attacked by any piece of each side
+	U64 double_attacks[2]; //Squares attacked at least twice by each side
+	U64 king_zone[2]; //Each king's square and the squares next to it
+	int king_zone_attackers[2]; //Enemy pieces attacking each side's king zone
+	int king_attack_units[2]; //Sum of king_attack_weights for those pieces
+	int mobility[2]; //Squares each side's minor and major pieces reach that are not own pieces or enemy pawn attacks
+	U64 checkers; //Pieces giving check to the side to move
+}ATTACK_INFO_STRUCT;
+
 typedef struct
 {
 	int board_array[64]; 
@@ -217,8 +306,7 @@ typedef struct
 	int big_material[2]; //Non-pawn material
 	int pawn_material[2];
 
-	int middle_piece_square_score;
-	int end_piece_square_score;
+	SCORE piece_square_score; //Middle and end game piece square scores, white minus black
 
 	int eval_score; //Overall evaluation score
 
@@ -227,17 +315,48 @@ typedef struct
 
 	UNDO_LIST_STRUCT undo_list;
 
-	int the_killers[MAX_SEARCH_DEPTH][2];
+	U16 the_killers[MAX_SEARCH_DEPTH][2]; //Compact moves
+
+	PV_LIST_STRUCT pv_table[MAX_SEARCH_DEPTH + 1]; //Triangular pv array, pv_table[ply] is the best line found from that ply
 
 	int history[64][64];
 	int history_max;
 
+	short nn_accumulator[2][NN_HIDDEN]; //First network layer for each side, updated as pieces move
+
+	ATTACK_INFO_STRUCT attack_info[MAX_SEARCH_DEPTH + 1]; //Attack maps for the position at each ply, see Get_Attack_Info
+
 	U64 hash_key;
 	U64 pawn_hash_key;
 	int age; //number of irreversible moves made
 
 } BOARD_STRUCT;
 
+typedef struct SPLIT_POINT_STRUCT
+{
+	BOARD_STRUCT board; //Split node position, copied by helpers when they join
+	MOVE_LIST_STRUCT move_list; //Shared move list, moves are handed out under the lock
+	int next_move; //Index of the next move to hand out
+	std::atomic<int> moves_made; //Legal moves made at this node, used for reductions
+
+	int alpha;
+	int beta;
+	int depth;
+	int in_check;
+	int age;
+
+	int best_score;
+	int best_move;
+	int best_move_score; //Move ordering score of the best move, used for killers
+
+	std::atomic<int> cutoff; //Set on a beta cutoff or stop, everyone below this point gives up
+	std::atomic<int> workers; //Helpers currently searching from this split point
+	std::atomic<long> nodes; //Nodes searched by helpers, added to the owner's count
+	std::atomic<long> tb_hits; //Tablebase hits of helpers, added the same way
+	struct SPLIT_POINT_STRUCT *parent; //Split point the owner was searching under
+	std::mutex lock;
+}SPLIT_POINT_STRUCT;
+
 
 /***** Global Functions *****/
 //attack
@@ -245,6 +364,9 @@ extern int Under_Attack(int sq, int side, BOARD_STRUCT *board);
 extern int In_Check(int side, BOARD_STRUCT *board);
 extern U64 between[64][64]; 
 extern void Generate_Between_Squares(void);
+extern U64 Attackers_To(int sq, U64 occ, BOARD_STRUCT *board);
+extern void Compute_Attack_Info(ATTACK_INFO_STRUCT *ai, BOARD_STRUCT *board);
+extern ATTACK_INFO_STRUCT *Get_Attack_Info(BOARD_STRUCT *board);
 
 //attack masks
 extern const U64 knight_attack_masks[64];
@@ -257,6 +379,9 @@ extern void Generate_King_Knight_Attack_Masks(void);
 extern void Generate_Pawn_Attack_Masks(void);
 extern void Generate_Rook_Bishop_Attack_Masks(void);
 
+//batch
+extern void Eval_Batch(char *line);
+
 //board
 extern void Init_Board(BOARD_STRUCT *board);
 extern void Update_Piece_Lists(BOARD_STRUCT *board);
@@ -265,6 +390,7 @@ extern void Add_To_Piecelists(int piece, int square, BOARD_STRUCT *board);
 extern void Remove_From_Piecelists(int piece, int square, BOARD_STRUCT *board);
 extern void Parse_Fen(char *fen, BOARD_STRUCT *board);
 extern void Clear_Undo_List(BOARD_STRUCT *board);
+extern void Copy_Position(BOARD_STRUCT *dest, BOARD_STRUCT *source);
 extern int Is_Repetition(BOARD_STRUCT *board);
 extern int Is_Threefold_Repetition(BOARD_STRUCT *board);
 extern int Is_Material_Draw(BOARD_STRUCT *board);
@@ -291,22 +417,34 @@ extern int futility_margins[6];
 extern int aspiration_windows[4];
 extern int piece_values[13];
 extern int passed_pawn_rank_bonus[8];
+extern int king_attack_weights[13];
+extern int king_attack_unit_scores[KING_ATTACK_UNITS_MAX + 1];
 extern short middle_piece_square_tables[13][64];
 extern short end_piece_square_tables[13][64];
+extern SCORE piece_square_tables[13][64];
+
+//egtb_gen
+extern void EGTB_Generate(char *line);
 
 //eval
 extern int Evaluate_Board(BOARD_STRUCT *board);
+extern int Lazy_Evaluate(int alpha, int beta, BOARD_STRUCT *board, int *is_bound);
 extern int Get_Board_Piece_Square_Score(BOARD_STRUCT *board);
 extern int Get_Piece_Square_Score(int square, int piece, float phase);
 extern int Get_Pawn_Eval_Score(BOARD_STRUCT *board);
+extern int Get_Pawn_Eval_Score_Per_Pawn(BOARD_STRUCT *board);
 extern int Get_King_Safety_Score(BOARD_STRUCT *board);
 extern int Get_Pawn_And_King_Score(BOARD_STRUCT *board);
 extern void Init_Pawn_Masks(void);
+extern void Init_Piece_Square_Tables(void);
 
 //hashkeys
 extern void Init_Hashkeys(void);
+extern void Alloc_Hash_Table(void);
 extern void Clear_Hash_Table(void);
 extern void Compute_Hash(BOARD_STRUCT *board);
+extern void Reset_Hashkeys(BOARD_STRUCT *board);
+extern void Prefetch_Hash_Entry(U64 hash);
 extern void Store_Hash_Entry(HASH_ENTRY_STRUCT *hash_ptr, int ply, SEARCH_INFO_STRUCT *info);
 extern int  Get_Hash_Entry(U64 hash, int alpha, int beta, int depth, int ply, int * hash_move);
 extern void Fill_Hash_Entry(int age, int depth, int eval, int flag, U64 hash, int move, HASH_ENTRY_STRUCT *hash_ptr);
@@ -319,7 +457,12 @@ extern void Clear_History_Data(BOARD_STRUCT *board);
 
 //input
 extern int Get_Time_Ms(void);
-extern void ReadInput(SEARCH_INFO_STRUCT *info);
+
+//kpk
+extern void Init_KPK_Bitbase(void);
+extern int Is_KPK(BOARD_STRUCT *board);
+extern int KPK_Probe(BOARD_STRUCT *board);
+extern int KPK_Evaluate(BOARD_STRUCT *board);
 
 //killers
 extern void Find_Killer_Moves(MOVE_LIST_STRUCT *move_list, BOARD_STRUCT *board);
@@ -368,11 +511,31 @@ extern void Find_Best_Recapture(MOVE_LIST_STRUCT *movelist, BOARD_STRUCT *board)
 extern int Movelists_Identical(MOVE_LIST_STRUCT *ptr1, MOVE_LIST_STRUCT *ptr2);
 extern void Clear_Movelist(MOVE_LIST_STRUCT *ptr);
 extern void Print_Move_List(MOVE_LIST_STRUCT *move_list);
+extern void Init_Root_Moves(ROOT_MOVE_LIST_STRUCT *root_moves, BOARD_STRUCT *board);
+extern void Sort_Root_Moves(ROOT_MOVE_LIST_STRUCT *root_moves, int first);
+
+//nnue
+extern int nn_loaded;
+extern int NN_Load(char *path);
+extern void NN_Refresh_Accumulator(BOARD_STRUCT *board);
+extern void NN_Add_Piece(int piece, int square, BOARD_STRUCT *board);
+extern void NN_Remove_Piece(int piece, int square, BOARD_STRUCT *board);
+extern void NN_Move_Piece(int piece, int from, int to, BOARD_STRUCT *board);
+extern int NN_Evaluate(BOARD_STRUCT *board);
+
+//numa
+extern int Numa_Node_Count(void);
+extern void Bind_Thread_To_Node(int node);
+extern void *Numa_Alloc(size_t size, int node);
+extern void *Numa_Alloc_Interleaved(size_t size);
+extern void Numa_Free(void *ptr);
 
 //pawn_hash_table
 extern void Add_Pawn_Hash_Entry(int score, U64 hash);
 extern int Get_Pawn_Hash_Entry(U64 hash);
 extern void Clear_Pawn_Hash_Table(void);
+extern void Alloc_Thread_Pawn_Hash_Table(void);
+extern void Free_Thread_Pawn_Hash_Table(void);
 
 //perft
 extern int Perft_Test(char *fen, int depth, BOARD_STRUCT *board);
@@ -382,14 +545,14 @@ extern int Search(BOARD_STRUCT *board, int depth);
 extern void Clear_PV_List(PV_LIST_STRUCT *pv);
 extern int Find_PV_Move(int move_num, MOVE_LIST_STRUCT *move_list);
 extern void Print_PV_List(PV_LIST_STRUCT *pv_list);
-extern void Get_PV_Line(int depth, PV_LIST_STRUCT *pv_list, BOARD_STRUCT *board);
+extern void Update_PV_Line(int move, PV_LIST_STRUCT *pv, PV_LIST_STRUCT *child_pv);
 
 //search
-extern int Search_Root(int alpha, int beta, int depth, BOARD_STRUCT *board, SEARCH_INFO_STRUCT *info);
-extern int Alpha_Beta(int alpha, int beta, int depth, PV_ENUM is_pv, NULL_ENUM do_null, BOARD_STRUCT *board, SEARCH_INFO_STRUCT *info);
+template <PV_ENUM node_type> int Alpha_Beta(int alpha, int beta, int depth, NULL_ENUM do_null, BOARD_STRUCT *board, SEARCH_INFO_STRUCT *info);
 extern int Quiescent_Search(int alpha, int beta, BOARD_STRUCT *board, SEARCH_INFO_STRUCT *info);
 extern int Search_Position(BOARD_STRUCT *board, SEARCH_INFO_STRUCT *info);
 extern void Internal_Iterative_Deepening(int alpha, int beta, int depth, MOVE_LIST_STRUCT *move_list, BOARD_STRUCT *board, SEARCH_INFO_STRUCT *info);
+extern void Search_Split_Point(SPLIT_POINT_STRUCT *sp, BOARD_STRUCT *board, SEARCH_INFO_STRUCT *info);
 
 //search_info
 extern void Clear_Search_Info(SEARCH_INFO_STRUCT *info);
@@ -397,6 +560,9 @@ extern void Calc_Move_Index_Data(SEARCH_INFO_STRUCT *info, float *best, float *b
 
 //search_test
 extern void Search_Test(void);
+extern void Node_Count_Test(int depth);
+extern void Pawn_Eval_Test(int passes);
+extern void TB_Test(char *path);
 
 //see
 extern int Static_Exchange_Evaluation(int move, BOARD_STRUCT *board);
@@ -405,6 +571,9 @@ extern void Set_Quiescent_SEE_Scores(MOVE_LIST_STRUCT *move_list, BOARD_STRUCT *
 //settings
 extern int use_SEE;
 extern int quiescent_SEE;
+extern int use_delta_pruning;
+extern int delta_margin;
+extern int use_see_pruning;
 extern int use_aspiration_window;
 extern int use_history;
 extern int only_research_in_pv;
@@ -413,13 +582,50 @@ extern int use_extra_lmr;
 extern double lmr_depth_mod;
 extern double lmr_move_mod;
 extern double lmr_pv_mod;
+extern char lmr_reductions[MAX_SEARCH_DEPTH][MAX_MOVE_LIST_LENGTH][2];
 extern int adapt_null_move;
 extern double null_move_depth_mod;
 extern int null_move_mat;
 extern int test[6];
 extern int use_futility;
 extern int use_late_move_reduction;
-extern void Set_Option(char *line);
+extern int iid_mode;
+extern int move_overhead;
+extern int deterministic;
+extern int multi_pv;
+extern int num_threads;
+extern int smp_mode;
+extern int use_numa;
+extern int use_nnue;
+extern int use_attack_eval;
+extern int use_attack_ordering;
+extern int use_lazy_eval;
+extern int lazy_eval_margin;
+extern int use_tb_probe;
+extern void Init_LMR_Table(void);
+extern void Set_Option(char *line, BOARD_STRUCT *board);
+
+//smp
+extern void Init_Threads(int num);
+extern void Start_Helpers(BOARD_STRUCT *board, SEARCH_INFO_STRUCT *info);
+extern void Stop_Helpers(void);
+extern int Can_Split(SEARCH_INFO_STRUCT *info);
+extern int Split(int alpha, int beta, int depth, int in_check, int first_move, int moves_made, MOVE_LIST_STRUCT *move_list, int *best_move, int *best_move_score, BOARD_STRUCT *board, SEARCH_INFO_STRUCT *info);
+extern int Split_Aborted(SPLIT_POINT_STRUCT *sp);
+
+//syzygy
+extern int tb_largest;
+extern int tb_cardinality;
+extern void TB_Init(char *path);
+extern int TB_Probe_WDL(BOARD_STRUCT *board, int *success);
+extern int TB_Probe_DTZ(BOARD_STRUCT *board, int *success);
+extern int TB_Root_Probe(BOARD_STRUCT *board, SEARCH_INFO_STRUCT *info);
+
+//time_manager
+extern void Set_Time_Limits(int time, int inc, int movestogo, int movetime, SEARCH_INFO_STRUCT *info);
+extern int Soft_Time_Up(int stable_iterations, int score_drop, int best_move_effort, SEARCH_INFO_STRUCT *info);
+extern void Check_Ponderhit(SEARCH_INFO_STRUCT *info);
+extern int Search_Limit_Reached(SEARCH_INFO_STRUCT *info);
 
 //tuning
 extern int king_end_piece_square_tuning_values[8];
@@ -4,6 +4,7 @@
 #include "globals.h"
 #include "stdlib.h"
 #include "time.h"
+#include "xmmintrin.h"
 
 //Hashkey data
 U64 piece_keys[13][64];//[square][piece]
@@ -11,10 +12,11 @@ U64 side_keys[2];
 U64 ep_keys[101]; //NO_SQUARE = 100;
 U64 castle_keys[16];
 
+#define ZOBRIST_SEED 1 //Seed for hashkeys in deterministic mode
 #define DUAL_HASH_SIZE 500000 //Number of hash entries stored
 int HASH_SIZE_MB = 0;
 
-HASH_ENTRY_STRUCT dual_hash_table[2][DUAL_HASH_SIZE];
+HASH_ENTRY_STRUCT (*dual_hash_table)[2] = NULL; //Both slots of an index share a cache line, allocated by Alloc_Hash_Table
 
 static void Copy_Hash_Entry(HASH_ENTRY_STRUCT *ptr1, HASH_ENTRY_STRUCT *ptr2);
 
@@ -23,8 +25,8 @@ void Init_Hashkeys(void)
 {
 	int index, index2;
 
-	//Set rand seed
-	srand(time(NULL));
+	//Set rand seed, fixed in deterministic mode so searches can be repeated
+	srand(deterministic ? ZOBRIST_SEED : (unsigned int)time(NULL));
 	//Piece keys
 	for (index = 0; index < 64; index++)
 	{
@@ -80,84 +82,85 @@ void Compute_Hash(BOARD_STRUCT *board)
 	HASH_IN(board->hash_key, castle_keys[board->castle_rights]);
 }
 
+//Generates new hashkeys and recomputes the keys of a board, moves are taken back and replayed so the undo list used for repetitions matches
+void Reset_Hashkeys(BOARD_STRUCT *board)
+{
+	int moves[MAX_PLY];
+	int num = board->undo_list.num;
+	int index;
+
+	for (index = num - 1; index >= 0; index--)
+	{
+		moves[index] = board->undo_list.list[index].move_num;
+		Take_Move(board);
+	}
+
+	Init_Hashkeys();
+	Compute_Hash(board);
+
+	for (index = 0; index < num; index++)
+	{
+		Make_Move(moves[index], board);
+	}
+}
+
 //Adds an entry to the two-tiered hash table
 void Store_Hash_Entry(HASH_ENTRY_STRUCT *hash_ptr, int ply, SEARCH_INFO_STRUCT *info)
 {
 	int hash_index = hash_ptr->hash % DUAL_HASH_SIZE;
 
-	//Adjust mate score for ply
-	if (hash_ptr->eval >= MATE_SCORE - MAX_SEARCH_DEPTH && hash_ptr->eval <= MATE_SCORE) hash_ptr->eval += ply;
-	if (hash_ptr->eval <= -MATE_SCORE + MAX_SEARCH_DEPTH && hash_ptr->eval >= -MATE_SCORE) hash_ptr->eval -= ply;
+	//Adjust mate and tablebase scores for ply, so they count from this position
+	if (IS_PLY_SCORE(hash_ptr->eval)) hash_ptr->eval += (hash_ptr->eval > 0) ? ply : -ply;
 
 	//Replace first slot if deeper or newer
-	if (dual_hash_table[0][hash_index].depth < hash_ptr->depth || dual_hash_table[0][hash_index].age < hash_ptr->age)
+	if (dual_hash_table[hash_index][0].depth < hash_ptr->depth || dual_hash_table[hash_index][0].age < hash_ptr->age)
 	{
-		Copy_Hash_Entry(hash_ptr, &dual_hash_table[0][hash_index]);
+		Copy_Hash_Entry(hash_ptr, &dual_hash_table[hash_index][0]);
 	}
 	else //Copy into second slot
 	{
-		Copy_Hash_Entry(hash_ptr, &dual_hash_table[1][hash_index]);
+		Copy_Hash_Entry(hash_ptr, &dual_hash_table[hash_index][1]);
 	}
 }
 
-//Returns the value of probing the dual hash table
+//Starts loading the table index for a hash into cache before it is probed
+void Prefetch_Hash_Entry(U64 hash)
+{
+	_mm_prefetch((char *)&dual_hash_table[hash % DUAL_HASH_SIZE][0], _MM_HINT_T0);
+}
+
+//Returns the value of probing the dual hash table, hash_move is set to the compact move
 int Get_Hash_Entry(U64 hash, int alpha, int beta, int depth, int ply, int * hash_move)
 {
-	//Get hash data
-	HASH_ENTRY_STRUCT *hash_temp = &dual_hash_table[0][hash % DUAL_HASH_SIZE];
+	HASH_ENTRY_STRUCT hash_temp;
+	int slot;
 
-	//Try first slot
-	if (hash_temp->hash == hash) //If hash keys match
+	for (slot = 0; slot < 2; slot++)
 	{
-		*hash_move = hash_temp->move; //Store hash move in pointer
+		//Read the data word once, other threads may be writing this slot
+		hash_temp.data = dual_hash_table[hash % DUAL_HASH_SIZE][slot].data;
+		hash_temp.hash = dual_hash_table[hash % DUAL_HASH_SIZE][slot].hash ^ hash_temp.data;
 
-		if (hash_temp->depth >= depth) //If depth is greater than or equal to search depth
-		{
-			//Adjust mate score for ply
-			int eval = hash_temp->eval;
+		if (hash_temp.hash != hash) continue; //Different position or torn entry
 
-			if (eval >= MATE_SCORE - MAX_SEARCH_DEPTH) eval -= ply;
-			else if (eval <= -MATE_SCORE + MAX_SEARCH_DEPTH) eval += ply;
+		*hash_move = hash_temp.move; //Store hash move in pointer
 
-			if (hash_temp->flag == HASH_EXACT)
-			{
-				return eval;
-			}
-			else if (hash_temp->flag == HASH_UPPER && (eval <= alpha))
-			{
-				return eval;
-			}
-			else if (hash_temp->flag == HASH_LOWER && (eval >= beta))
-			{
-				return eval;
-			}
-			//return INVALID;
-		}
-	}
-	
-	//Check second slot
-	hash_temp = &dual_hash_table[1][hash % DUAL_HASH_SIZE];
-	if (hash_temp->hash == hash) //If hash keys match
-	{
-		*hash_move = hash_temp->move; //Store hash move in pointer
-
-		if (hash_temp->depth >= depth) //If depth is greater than or equal to search depth
+		if (hash_temp.depth >= depth) //If depth is greater than or equal to search depth
 		{
-			//Adjust mate score for ply
-			int eval = hash_temp->eval;
+			//Adjust mate and tablebase scores for ply
+			int eval = hash_temp.eval;
 
-			if (eval >= MATE_SCORE - MAX_SEARCH_DEPTH) eval -= ply;
-			else if (eval <= -MATE_SCORE + MAX_SEARCH_DEPTH) eval += ply;
+			if (IS_PLY_SCORE(eval)) eval -= (eval > 0) ? ply : -ply;
 
-			if (hash_temp->flag == HASH_EXACT)
+			if (hash_temp.flag == HASH_EXACT)
 			{
 				return eval;
 			}
-			else if (hash_temp->flag == HASH_UPPER && (eval <= alpha))
+			else if (hash_temp.flag == HASH_UPPER && (eval <= alpha))
 			{
 				return eval;
 			}
-			else if (hash_temp->flag == HASH_LOWER && (eval >= beta))
+			else if (hash_temp.flag == HASH_LOWER && (eval >= beta))
 			{
 				return eval;
 			}
@@ -177,24 +180,29 @@ void Fill_Hash_Entry(int age, int depth, int eval, int flag, U64 hash, int move,
 	hash_ptr->eval = eval;
 	hash_ptr->flag = flag;
 	hash_ptr->hash = hash;
-	hash_ptr->move = move;
+	hash_ptr->move = TO_COMPACT_MOVE(move);
 }
 
-//Copies hash struct data from pointer 1 to pointer 2
+//Copies hash struct data from pointer 1 to table slot pointer 2, the key is stored xored with the data
 void Copy_Hash_Entry(HASH_ENTRY_STRUCT *ptr1, HASH_ENTRY_STRUCT *ptr2)
 {
-	//Copy ptr1 data into ptr 2
-	ptr2->age = ptr1->age;
-	ptr2->depth = ptr1->depth;
-	ptr2->eval = ptr1->eval;
-	ptr2->flag = ptr1->flag;
-	ptr2->hash = ptr1->hash;
-	ptr2->move = ptr1->move;
+	ptr2->hash = ptr1->hash ^ ptr1->data;
+	ptr2->data = ptr1->data;
 }
 
 
+//Allocates and clears the hash table, pages are interleaved over numa nodes when the numa option is set
+void Alloc_Hash_Table(void)
+{
+	size_t size = DUAL_HASH_SIZE * sizeof(*dual_hash_table);
+
+	Numa_Free(dual_hash_table);
+	dual_hash_table = (HASH_ENTRY_STRUCT(*)[2])(use_numa ? Numa_Alloc_Interleaved(size) : Numa_Alloc(size, -1));
+	Clear_Hash_Table();
+}
+
 //Initializes hash table and clears all entries
 void Clear_Hash_Table(void)
 {
-	memset(dual_hash_table, 0, sizeof(dual_hash_table));
+	memset(dual_hash_table, 0, DUAL_HASH_SIZE * sizeof(*dual_hash_table));
 }
\ No newline at end of file
@@ -12,7 +12,7 @@ void Add_Killer_Move(int move, BOARD_STRUCT *board)
 	//Automatically shift
 	//board->the_killers[ply][2].move = board->the_killers[ply][1].move;
 	board->the_killers[ply][1] = board->the_killers[ply][0];
-	board->the_killers[ply][0] = move;
+	board->the_killers[ply][0] = TO_COMPACT_MOVE(move);
 	return;
 	
 
@@ -40,7 +40,8 @@ void Add_Killer_Move(int move, BOARD_STRUCT *board)
 //Finds killer moves (if any) in movelist and sets their scores higher
 void Find_Killer_Moves(MOVE_LIST_STRUCT *move_list, BOARD_STRUCT *board)
 {
-	int killer_index, killer_move, move_index;
+	int killer_index, move_index;
+	U16 killer_move;
 	int ply = board->hply;
 
 	//Loop through each killer move, subtracting the move index from the final score to weight first killers higher
@@ -54,7 +55,7 @@ void Find_Killer_Moves(MOVE_LIST_STRUCT *move_list, BOARD_STRUCT *board)
 		for (move_index = 0; move_index < move_list->num; move_index++)
 		{
 			//If the move found matches the killer move and is not already scored higher
-			if (move_list->list[move_index].move == killer_move && move_list->list[move_index].score < KILLER_MOVE_SCORE)
+			if (TO_COMPACT_MOVE(move_list->list[move_index].move) == killer_move && move_list->list[move_index].score < KILLER_MOVE_SCORE)
 			{
 				move_list->list[move_index].score = KILLER_MOVE_SCORE - killer_index; //Subtract killer index to give previous killer priority
 				break;
@@ -75,7 +76,7 @@ void Find_Killer_Moves(MOVE_LIST_STRUCT *move_list, BOARD_STRUCT *board)
 		for (move_index = 0; move_index < move_list->num; move_index++)
 		{
 			//If the move found matches the killer move and is not already scored higher
-			if (move_list->list[move_index].move == killer_move && move_list->list[move_index].score < KILLER_MOVE_SCORE - 2)
+			if (TO_COMPACT_MOVE(move_list->list[move_index].move) == killer_move && move_list->list[move_index].score < KILLER_MOVE_SCORE - 2)
 			{
 				move_list->list[move_index].score = KILLER_MOVE_SCORE - killer_index - 2; //Subtract killer index to give previous killer priority
 				break;
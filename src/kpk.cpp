@@ -0,0 +1,182 @@
+/* kpk.cpp
+* Contains the king and pawn against king bitbase, generated at startup
+* Theo Kanning
+*/
+
+#include "globals.h"
+#include "stdlib.h"
+#include "string.h"
+#include "windows.h"
+
+using namespace std;
+
+/* Positions are stored with white as the side with the pawn and the pawn on files a to d, other positions are flipped to match
+Index bits: white king 0-5, black king 6-11, side to move 12, pawn file 13-14, 7th rank minus pawn rank 15-17 */
+
+#define KPK_SIZE			(2 * 24 * 64 * 64) //Sides x pawn squares x king squares
+#define KPK_WIN_SCORE		1000 //Base score for a won position, pawn rank is added so the search pushes it
+
+enum KPK_RESULT_ENUM //Bit flags so the results of every move can be combined with |
+{
+	KPK_INVALID = 0, KPK_UNKNOWN = 1, KPK_DRAW = 2, KPK_WIN = 4
+};
+
+static unsigned int kpk_bitbase[KPK_SIZE / 32]; //One bit per position, set if white wins
+
+static inline int KPK_Index(int side, int black_king, int white_king, int pawn)
+{
+	return white_king | (black_king << 6) | (side << 12) | (GET_FILE(pawn) << 13) | ((RANK_7 - GET_RANK(pawn)) << 15);
+}
+
+static inline int Distance(int sq1, int sq2)
+{
+	return max(abs(GET_FILE(sq1) - GET_FILE(sq2)), abs(GET_RANK(sq1) - GET_RANK(sq2)));
+}
+
+//Returns the result of a position that can be decided without looking at its moves
+static char KPK_Initial_Result(int index)
+{
+	int white_king = index & 0x3f;
+	int black_king = (index >> 6) & 0x3f;
+	int side = (index >> 12) & 1;
+	int pawn_rank = RANK_7 - ((index >> 15) & 7);
+	int pawn_file = (index >> 13) & 3;
+	int pawn = RANK_FILE_TO_SQUARE(pawn_rank, pawn_file);
+
+	//Two pieces on one square, kings touching, or black in check with white to move
+	if (Distance(white_king, black_king) <= 1
+		|| white_king == pawn
+		|| black_king == pawn
+		|| (side == WHITE && GET_BIT(wpawn_attack_masks[pawn], black_king)))
+		return KPK_INVALID;
+
+	//Pawn promotes and the queen cannot be taken
+	if (side == WHITE
+		&& GET_RANK(pawn) == RANK_7
+		&& white_king != pawn + 8
+		&& (Distance(black_king, pawn + 8) > 1 || Distance(white_king, pawn + 8) == 1))
+		return KPK_WIN;
+
+	//Stalemate, or black takes an undefended pawn
+	if (side == BLACK)
+	{
+		U64 black_moves = king_attack_masks[black_king] & ~king_attack_masks[white_king];
+
+		if (!(black_moves & ~wpawn_attack_masks[pawn]) || GET_BIT(black_moves, pawn)) return KPK_DRAW;
+	}
+
+	return KPK_UNKNOWN;
+}
+
+//Combines the results after every move from an unknown position
+//White needs one winning move, black needs one drawing move, if any move is still unknown so is the position
+static char KPK_Classify(int index, char *results)
+{
+	int white_king = index & 0x3f;
+	int black_king = (index >> 6) & 0x3f;
+	int side = (index >> 12) & 1;
+	int pawn_rank = RANK_7 - ((index >> 15) & 7);
+	int pawn_file = (index >> 13) & 3;
+	int pawn = RANK_FILE_TO_SQUARE(pawn_rank, pawn_file);
+	char result = KPK_INVALID; //Illegal moves lead to invalid positions and add nothing
+	U64 moves;
+
+	if (side == WHITE)
+	{
+		moves = king_attack_masks[white_king];
+		while (moves) result |= results[KPK_Index(BLACK, black_king, pop_1st_bit(&moves), pawn)];
+
+		//Promotions were decided in KPK_Initial_Result
+		if (GET_RANK(pawn) < RANK_7) result |= results[KPK_Index(BLACK, black_king, white_king, pawn + 8)];
+		if (GET_RANK(pawn) == RANK_2 && pawn + 8 != white_king && pawn + 8 != black_king) result |= results[KPK_Index(BLACK, black_king, white_king, pawn + 16)];
+
+		return (result & KPK_WIN) ? KPK_WIN : (result & KPK_UNKNOWN) ? KPK_UNKNOWN : KPK_DRAW;
+	}
+	else
+	{
+		moves = king_attack_masks[black_king];
+		while (moves) result |= results[KPK_Index(WHITE, pop_1st_bit(&moves), white_king, pawn)];
+
+		return (result & KPK_DRAW) ? KPK_DRAW : (result & KPK_UNKNOWN) ? KPK_UNKNOWN : KPK_WIN;
+	}
+}
+
+//Builds the bitbase by retrograde iteration, unknown positions are classified from their moves until nothing changes
+void Init_KPK_Bitbase(void)
+{
+	char *results = new char[KPK_SIZE];
+	int changed;
+
+	for (int index = 0; index < KPK_SIZE; index++) results[index] = KPK_Initial_Result(index);
+
+	do
+	{
+		changed = 0;
+		for (int index = 0; index < KPK_SIZE; index++)
+		{
+			if (results[index] == KPK_UNKNOWN && (results[index] = KPK_Classify(index, results)) != KPK_UNKNOWN) changed = 1;
+		}
+	} while (changed);
+
+	memset(kpk_bitbase, 0, sizeof(kpk_bitbase));
+	for (int index = 0; index < KPK_SIZE; index++)
+	{
+		if (results[index] == KPK_WIN) kpk_bitbase[index >> 5] |= 1u << (index & 31);
+	}
+
+	delete[] results;
+}
+
+//Returns 1 if the board has only kings and one pawn
+int Is_KPK(BOARD_STRUCT *board)
+{
+	return board->big_material[WHITE] == 0 && board->big_material[BLACK] == 0 && board->piece_num[wP] + board->piece_num[bP] == 1;
+}
+
+//Returns 1 if the side with the pawn wins, the board must pass Is_KPK
+int KPK_Probe(BOARD_STRUCT *board)
+{
+	const int strong = board->piece_num[wP] ? WHITE : BLACK;
+	U64 temp;
+
+	temp = board->piece_bitboards[strong == WHITE ? wK : bK];
+	int white_king = pop_1st_bit(&temp);
+	temp = board->piece_bitboards[strong == WHITE ? bK : wK];
+	int black_king = pop_1st_bit(&temp);
+	temp = board->piece_bitboards[strong == WHITE ? wP : bP];
+	int pawn = pop_1st_bit(&temp);
+	int side = board->side;
+
+	//Flip ranks so the pawn is white's
+	if (strong == BLACK)
+	{
+		white_king ^= 56;
+		black_king ^= 56;
+		pawn ^= 56;
+		side ^= 1;
+	}
+
+	//Mirror files so the pawn is on files a to d
+	if (GET_FILE(pawn) > FILE_D)
+	{
+		white_king ^= 7;
+		black_king ^= 7;
+		pawn ^= 7;
+	}
+
+	int index = KPK_Index(side, black_king, white_king, pawn);
+	return (kpk_bitbase[index >> 5] >> (index & 31)) & 1;
+}
+
+//Returns the exact score for the side to move, 0 for a draw and a large score for a win that grows as the pawn advances
+int KPK_Evaluate(BOARD_STRUCT *board)
+{
+	if (!KPK_Probe(board)) return 0;
+
+	const int strong = board->piece_num[wP] ? WHITE : BLACK;
+	U64 temp = board->piece_bitboards[strong == WHITE ? wP : bP];
+	int pawn = pop_1st_bit(&temp);
+	int score = KPK_WIN_SCORE + 10 * ((strong == WHITE) ? GET_RANK(pawn) : RANK_8 - GET_RANK(pawn));
+
+	return (board->side == strong) ? score : -score;
+}
@@ -32,13 +32,16 @@ int main()
 {
 	cout << PROGRAM_NAME << " version " << VERSION_NO << endl << AUTHOR << endl;
 	Init_Hashkeys();
-	Clear_Hash_Table();
+	Alloc_Hash_Table();
 	Clear_Pawn_Hash_Table();
 	Init_Pawn_Masks();
 	Init_Board(&board);
 	Generate_Magic_Moves();
 	Generate_Between_Squares();
 	Set_King_End_Values();
+	Init_Piece_Square_Tables();
+	Init_LMR_Table();
+	Init_KPK_Bitbase();
 	Clear_History_Data(&board);
 
 
@@ -72,6 +75,7 @@ int main()
 			Print_Board(&board);
 			info.stop_time = 100000;
 			info.depth = 25;
+			Clear_Search_Info(&info);
 			Search_Position(&board, &info);
 			system("PAUSE");
 			//break;
@@ -95,14 +99,36 @@ int main()
 			Search_Test();
 			system("PAUSE");
 		}
+		else if (!strncmp(line, "node_test", 9)) {
+			int depth = atoi(line + 9);
+			Node_Count_Test((depth > 0) ? depth : 8);
+		}
+		else if (!strncmp(line, "pawn_test", 9)) {
+			int passes = atoi(line + 9);
+			Pawn_Eval_Test((passes > 0) ? passes : 100000);
+		}
+		else if (!strncmp(line, "tb_test", 7)) {
+			line[strcspn(line, "\r\n")] = '\0';
+			TB_Test(line[7] == ' ' ? line + 8 : (char *)"<empty>");
+		}
+		else if (!strncmp(line, "eval_batch", 10)) {
+			line[strcspn(line, "\r\n")] = '\0';
+			Eval_Batch(line);
+		}
+		else if (!strncmp(line, "egtb_gen", 8)) {
+			line[strcspn(line, "\r\n")] = '\0';
+			EGTB_Generate(line);
+		}
 		else if (!strncmp(line, "setoption", 9)) {
-			Set_Option(line);
+			Set_Option(line, &board);
 		}
 		else if (!strncmp(line, "quit", 4))	{
 			break;
 		}
 	}
 
+	Init_Threads(1); //Join helper threads before leaving the uci loop
+
 	Parse_Fen("8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 0", &board);
 	Print_Board(&board);
 	while (!done)
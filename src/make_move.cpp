@@ -31,6 +31,12 @@ bit  [22:24] Special flags
 	1 0 1 Promote to rook
 	1 1 0 Promote to bishop
 	1 1 1 Promote to knight
+
+Compact move data structure
+16 bit integer used in hash and killer storage
+bits [0:5] from square index 64
+bits [6:11] to square index 64
+bits [12:14] Special flags, same as above
 */
 
 int Make_Move(int move_num, BOARD_STRUCT *board)
@@ -301,6 +307,9 @@ int Make_Move(int move_num, BOARD_STRUCT *board)
 		}
 	}
 
+	//Hash key is final, start loading the table entry while the check test runs
+	Prefetch_Hash_Entry(board->hash_key);
+
 	/***** Check test *****/
 	//If king under attack
 	if (In_Check(side, board))
@@ -584,6 +593,7 @@ void Move_Piece(int from, int to, BOARD_STRUCT *board)
 		HASH_OUT(board->pawn_hash_key, piece_keys[piece][from]);
 		HASH_IN(board->pawn_hash_key, piece_keys[piece][to]);
 	}
+	if (use_nnue) NN_Move_Piece(piece, from, to, board);
 }
 
 //Removes a piece from the board, updating all lists, bitboards, and hashes
@@ -606,6 +616,7 @@ void Remove_Piece(int square, BOARD_STRUCT *board)
 	{
 		HASH_OUT(board->pawn_hash_key, piece_keys[piece][square]);
 	}
+	if (use_nnue) NN_Remove_Piece(piece, square, board);
 }
 //Adds piece to board after promotion
 void Add_Piece(int piece, int square, BOARD_STRUCT *board)
@@ -625,6 +636,7 @@ void Add_Piece(int piece, int square, BOARD_STRUCT *board)
 	{
 		HASH_IN(board->pawn_hash_key, piece_keys[piece][square]);
 	}
+	if (use_nnue) NN_Add_Piece(piece, square, board);
 }
 
 //Returns 1 if the move generates check
@@ -61,6 +61,16 @@
 #define CLEAR_CAPTURE(x)		((x &= ~(captureMask << captureShift)))
 #define CLEAR_SPECIAL(x)		((x &= ~(specialMask << specialShift)))
 
+//Compact 16 bit moves for hash, killer and pv storage
+#define compactToShift			6
+#define compactSpecialShift		12
+#define compactSqMask			0x3f
+
+#define TO_COMPACT_MOVE(x)		((U16)(GET_FROM_SQ(x) | (GET_TO_SQ(x) << compactToShift) | (GET_SPECIAL(x) << compactSpecialShift)))
+#define GET_COMPACT_FROM_SQ(x)	((x) & compactSqMask)
+#define GET_COMPACT_TO_SQ(x)	(((x) >> compactToShift) & compactSqMask)
+#define GET_COMPACT_SPECIAL(x)	(((x) >> compactSpecialShift) & specialMask)
+
 //Moves scores
 #define PV_SCORE				1000000
 #define WINNING_CAPTURE_SCORE	900000
@@ -96,4 +106,6 @@ const int KING_MOVES[8] = { -11, -10, -9, -1, 1, 9, 10, 11 };
 #define HASH_EMPTY				0
 #define HASH_EXACT				1
 #define HASH_LOWER				2
-#define HASH_UPPER				3
\ No newline at end of file
+#define HASH_UPPER				3
+
+#define HASH_QS_DEPTH			0 //Depth stored for quiescent search entries
\ No newline at end of file
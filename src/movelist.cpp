@@ -201,23 +201,24 @@ void Add_Move(MOVE_LIST_STRUCT *move_list, int from, int to, int piece, int capt
 	else //Check heuristics for scoring
 	{
 		move_list->list[move_list->num].score = 0;
+		U16 compact = TO_COMPACT_MOVE(temp);
 
 		//Killer moves
-		if (temp == board->the_killers[board->hply][0])//if move matches first killer move
+		if (compact == board->the_killers[board->hply][0])//if move matches first killer move
 		{
 			move_list->list[move_list->num].score = KILLER_MOVE_SCORE;
 		}
-		else if (temp == board->the_killers[board->hply][1])//if move matches second killer move
+		else if (compact == board->the_killers[board->hply][1])//if move matches second killer move
 		{
 			move_list->list[move_list->num].score = KILLER_MOVE_SCORE - 1;
 		}
 		else if (board->hply >= 2) //If killer moves from ply - 2 are available
 		{
-			if (temp == board->the_killers[board->hply - 2][0])//if move matches first killer move
+			if (compact == board->the_killers[board->hply - 2][0])//if move matches first killer move
 			{
 				move_list->list[move_list->num].score = KILLER_MOVE_SCORE - 2;
 			}
-			else if (temp == board->the_killers[board->hply - 2][1])//if move matches second killer move
+			else if (compact == board->the_killers[board->hply - 2][1])//if move matches second killer move
 			{
 				move_list->list[move_list->num].score = KILLER_MOVE_SCORE - 3;
 			}
@@ -239,6 +240,15 @@ void Add_Move(MOVE_LIST_STRUCT *move_list, int from, int to, int piece, int capt
 				move_list->list[move_list->num].score = middle_piece_square_tables[piece][to] - middle_piece_square_tables[piece][from];
 			}
 		}
+
+		//Pieces moved onto a square an enemy pawn attacks go after the other quiet moves
+		if (use_attack_ordering
+			&& !IS_PAWN(piece)
+			&& move_list->list[move_list->num].score <= HISTORY_SCORE_MAX
+			&& GET_BIT(Get_Attack_Info(board)->piece_attacks[board->side == WHITE ? bP : wP], to))
+		{
+			move_list->list[move_list->num].score -= 2 * HISTORY_SCORE_MAX;
+		}
 	}
 	
 	move_list->num++; //Increment counter
@@ -293,4 +303,55 @@ void Print_Move_List(MOVE_LIST_STRUCT *move_list)
 
 		cout << " Score: " << move_list->list[index].score << endl;
 	}
+}
+
+//Fills the root move list with all legal moves, sorted by their generation scores
+void Init_Root_Moves(ROOT_MOVE_LIST_STRUCT *root_moves, BOARD_STRUCT *board)
+{
+	MOVE_LIST_STRUCT move_list;
+	ROOT_MOVE_STRUCT *root_move;
+
+	Generate_Moves(board, &move_list);
+	Sort_Moves(&move_list);
+
+	root_moves->num = 0;
+	for (int i = 0; i < move_list.num; i++)
+	{
+		if (!Make_Move(move_list.list[i].move, board)) continue; //Only keep legal moves
+		Take_Move(board);
+
+		root_move = &root_moves->list[root_moves->num++];
+		root_move->move = move_list.list[i].move;
+		root_move->order_score = move_list.list[i].score;
+		root_move->score = -INF;
+		root_move->prev_score = -INF;
+		root_move->nodes = 0;
+	}
+}
+
+//Returns 1 if root move 1 should be searched before root move 2
+//Ordering the rest by subtree size was tried and searched 4-8% more nodes in node_test
+static int Root_Move_First(ROOT_MOVE_STRUCT *move1, ROOT_MOVE_STRUCT *move2)
+{
+	if (move1->score != move2->score) return move1->score > move2->score;
+	return move1->prev_score > move2->prev_score;
+}
+
+//Orders root moves from index first by score, then previous score, ties keep their current order
+//Moves before first belong to multipv lines that are already searched
+void Sort_Root_Moves(ROOT_MOVE_LIST_STRUCT *root_moves, int first)
+{
+	ROOT_MOVE_STRUCT temp;
+	int j;
+
+	//Insertion sort is stable and the list is nearly sorted after the first iteration
+	for (int i = first + 1; i < root_moves->num; i++)
+	{
+		temp = root_moves->list[i];
+		for (j = i; j > first && Root_Move_First(&temp, &root_moves->list[j - 1]); j--)
+		{
+			root_moves->list[j] = root_moves->list[j - 1];
+		}
+		root_moves->list[j] = temp;
+	}
 }
\ No newline at end of file
@@ -0,0 +1,186 @@
+/* nnue.cpp
+* Contains the efficiently updatable neural network evaluation
+* Theo Kanning
+*/
+
+#include "globals.h"
+#include "stdio.h"
+#include "string.h"
+#include "immintrin.h"
+
+/* Network layout
+768 inputs, one for each piece type, color and square, seen from each side
+Both sides share the first layer weights, black's inputs are flipped vertically with colors swapped
+The two NN_HIDDEN accumulators are clipped to [0, NN_QA], side to move first, and feed one output
+
+Weights file, little endian 16 bit integers in this order
+feature weights [768][NN_HIDDEN], scaled by NN_QA
+feature biases  [NN_HIDDEN], scaled by NN_QA
+output weights  [2 * NN_HIDDEN], scaled by NN_QB
+output bias     [1], scaled by NN_QA * NN_QB
+*/
+
+#define NN_INPUTS		768
+#define NN_QA			255 //First layer quantization
+#define NN_QB			64  //Output layer quantization
+#define NN_SCALE		400 //Output units to centipawns
+
+static short nn_feature_weights[NN_INPUTS][NN_HIDDEN];
+static short nn_feature_biases[NN_HIDDEN];
+static short nn_output_weights[2 * NN_HIDDEN];
+static short nn_output_bias;
+
+int nn_loaded = 0; //Set once a weights file has been read
+
+//Returns the input index of a piece on a square as seen by one side
+static inline int NN_Feature(int piece, int square, int perspective)
+{
+	int type = (piece - 1) % 6;
+
+	if (perspective == BLACK) square ^= 56; //Flip ranks
+	return ((COLOR(piece) != perspective) * 6 + type) * 64 + square;
+}
+
+//Loads network weights from a file, returns 1 if successful
+int NN_Load(char *path)
+{
+	FILE *file;
+	size_t read = 0;
+
+	if (fopen_s(&file, path, "rb") != 0 || file == NULL) return 0;
+
+	read += fread(nn_feature_weights, sizeof(short), NN_INPUTS * NN_HIDDEN, file);
+	read += fread(nn_feature_biases, sizeof(short), NN_HIDDEN, file);
+	read += fread(nn_output_weights, sizeof(short), 2 * NN_HIDDEN, file);
+	read += fread(&nn_output_bias, sizeof(short), 1, file);
+
+	//File must end exactly after the output bias
+	int extra = fgetc(file);
+	fclose(file);
+
+	nn_loaded = (read == NN_INPUTS * NN_HIDDEN + 3 * NN_HIDDEN + 1) && (extra == EOF);
+	return nn_loaded;
+}
+
+//Rebuilds both accumulators from the pieces on the board
+void NN_Refresh_Accumulator(BOARD_STRUCT *board)
+{
+	for (int side = WHITE; side <= BLACK; side++)
+	{
+		short *acc = board->nn_accumulator[side];
+
+		memcpy(acc, nn_feature_biases, sizeof(nn_feature_biases));
+
+		for (int square = 0; square < 64; square++)
+		{
+			int piece = board->board_array[square];
+			if (piece == EMPTY) continue;
+
+			short *weights = nn_feature_weights[NN_Feature(piece, square, side)];
+			for (int i = 0; i < NN_HIDDEN; i++) acc[i] += weights[i];
+		}
+	}
+}
+
+/***** Incremental Updates *****/
+/* Called by Move_Piece, Add_Piece and Remove_Piece, so Take_Move restores the accumulators by applying the inverse update */
+/* Integer adds are exact, so no copy of the previous accumulator is kept */
+
+void NN_Add_Piece(int piece, int square, BOARD_STRUCT *board)
+{
+	for (int side = WHITE; side <= BLACK; side++)
+	{
+		short *acc = board->nn_accumulator[side];
+		short *weights = nn_feature_weights[NN_Feature(piece, square, side)];
+
+		for (int i = 0; i < NN_HIDDEN; i++) acc[i] += weights[i];
+	}
+}
+
+void NN_Remove_Piece(int piece, int square, BOARD_STRUCT *board)
+{
+	for (int side = WHITE; side <= BLACK; side++)
+	{
+		short *acc = board->nn_accumulator[side];
+		short *weights = nn_feature_weights[NN_Feature(piece, square, side)];
+
+		for (int i = 0; i < NN_HIDDEN; i++) acc[i] -= weights[i];
+	}
+}
+
+//Moves a piece in one pass over each accumulator
+void NN_Move_Piece(int piece, int from, int to, BOARD_STRUCT *board)
+{
+	for (int side = WHITE; side <= BLACK; side++)
+	{
+		short *acc = board->nn_accumulator[side];
+		short *from_weights = nn_feature_weights[NN_Feature(piece, from, side)];
+		short *to_weights = nn_feature_weights[NN_Feature(piece, to, side)];
+
+		for (int i = 0; i < NN_HIDDEN; i++) acc[i] += to_weights[i] - from_weights[i];
+	}
+}
+
+/***** Inference *****/
+
+//Dot product of a clipped accumulator with output weights
+static int NN_Output_Sum(short *acc, short *weights)
+{
+#if defined(__AVX2__)
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i qa = _mm256_set1_epi16(NN_QA);
+	__m256i sum = _mm256_setzero_si256();
+
+	for (int i = 0; i < NN_HIDDEN; i += 16)
+	{
+		__m256i value = _mm256_loadu_si256((__m256i *)&acc[i]);
+		value = _mm256_min_epi16(_mm256_max_epi16(value, zero), qa);
+		sum = _mm256_add_epi32(sum, _mm256_madd_epi16(value, _mm256_loadu_si256((__m256i *)&weights[i])));
+	}
+
+	__m128i sum128 = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+	sum128 = _mm_add_epi32(sum128, _mm_shuffle_epi32(sum128, _MM_SHUFFLE(1, 0, 3, 2)));
+	sum128 = _mm_add_epi32(sum128, _mm_shuffle_epi32(sum128, _MM_SHUFFLE(2, 3, 0, 1)));
+	return _mm_cvtsi128_si32(sum128);
+#elif defined(__SSE4_1__) || defined(__AVX__)
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i qa = _mm_set1_epi16(NN_QA);
+	__m128i sum = _mm_setzero_si128();
+
+	for (int i = 0; i < NN_HIDDEN; i += 8)
+	{
+		__m128i value = _mm_loadu_si128((__m128i *)&acc[i]);
+		value = _mm_min_epi16(_mm_max_epi16(value, zero), qa);
+		sum = _mm_add_epi32(sum, _mm_madd_epi16(value, _mm_loadu_si128((__m128i *)&weights[i])));
+	}
+
+	sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+	sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+	return _mm_cvtsi128_si32(sum);
+#else
+	int sum = 0;
+
+	for (int i = 0; i < NN_HIDDEN; i++)
+	{
+		int value = acc[i];
+		if (value < 0) value = 0;
+		if (value > NN_QA) value = NN_QA;
+		sum += value * weights[i];
+	}
+	return sum;
+#endif
+}
+
+//Returns the network score in centipawns for the side to move
+int NN_Evaluate(BOARD_STRUCT *board)
+{
+	int sum = NN_Output_Sum(board->nn_accumulator[board->side], nn_output_weights)
+			+ NN_Output_Sum(board->nn_accumulator[board->side ^ 1], nn_output_weights + NN_HIDDEN);
+
+	int score = (int)((long long)(sum + nn_output_bias) * NN_SCALE / (NN_QA * NN_QB));
+
+	//Keep network scores below the tablebase and mate range, scores there are adjusted for ply in the hash table
+	if (score > TB_WIN_SCORE - MAX_SEARCH_DEPTH - 1) score = TB_WIN_SCORE - MAX_SEARCH_DEPTH - 1;
+	if (score < -TB_WIN_SCORE + MAX_SEARCH_DEPTH + 1) score = -TB_WIN_SCORE + MAX_SEARCH_DEPTH + 1;
+	return score;
+}
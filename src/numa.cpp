@@ -0,0 +1,70 @@
+/* numa.cpp
+* Contains functions for placing search threads and memory on numa nodes
+* Theo Kanning
+*/
+
+#include "globals.h"
+#include "windows.h"
+
+using namespace std;
+
+#define INTERLEAVE_SIZE		(64 * 1024) //Bytes committed on one node before moving to the next
+
+//Returns the number of numa nodes, 1 on machines without numa
+int Numa_Node_Count(void)
+{
+	ULONG highest_node = 0;
+
+	if (!GetNumaHighestNodeNumber(&highest_node)) return 1;
+	return (int)highest_node + 1;
+}
+
+//Restricts the calling thread to the processors of a numa node
+void Bind_Thread_To_Node(int node)
+{
+	GROUP_AFFINITY affinity;
+
+	if (GetNumaNodeProcessorMaskEx((USHORT)node, &affinity))
+	{
+		SetThreadGroupAffinity(GetCurrentThread(), &affinity, NULL);
+	}
+}
+
+//Allocates zeroed memory with its physical pages on one node, -1 for no preferred node
+void *Numa_Alloc(size_t size, int node)
+{
+	DWORD preferred = (node < 0) ? NUMA_NO_PREFERRED_NODE : (DWORD)node;
+	void *ptr = VirtualAllocExNuma(GetCurrentProcess(), NULL, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE, preferred);
+
+	if (ptr == NULL) ptr = VirtualAlloc(NULL, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE); //Node has no free memory
+	return ptr;
+}
+
+//Allocates zeroed memory with its pages spread evenly over all nodes
+//Used for tables that every thread reads, so no node serves all of the traffic
+void *Numa_Alloc_Interleaved(size_t size)
+{
+	int nodes = Numa_Node_Count();
+	char *base = (char *)VirtualAlloc(NULL, size, MEM_RESERVE, PAGE_READWRITE);
+
+	if (base == NULL) return NULL;
+
+	for (size_t offset = 0; offset < size; offset += INTERLEAVE_SIZE)
+	{
+		size_t chunk = min((size_t)INTERLEAVE_SIZE, size - offset);
+		int node = (int)((offset / INTERLEAVE_SIZE) % nodes);
+
+		if (VirtualAllocExNuma(GetCurrentProcess(), base + offset, chunk, MEM_COMMIT, PAGE_READWRITE, (DWORD)node) == NULL)
+		{
+			VirtualAlloc(base + offset, chunk, MEM_COMMIT, PAGE_READWRITE);
+		}
+	}
+
+	return base;
+}
+
+//Frees memory from Numa_Alloc or Numa_Alloc_Interleaved
+void Numa_Free(void *ptr)
+{
+	if (ptr != NULL) VirtualFree(ptr, 0, MEM_RELEASE);
+}
@@ -6,28 +6,33 @@
 #include "globals.h"
 
 typedef struct{
-	int score;
-	U64 hash;
+	U64 hash; //Stored xored with data so an entry torn by another thread fails the key check
+	U64 data; //Score in the low 32 bits
 }PAWN_HASH_ENTRY_STRUCT;
 
 int hash_size = 65536;
 
 PAWN_HASH_ENTRY_STRUCT pawn_hash_table[65536];
+static thread_local PAWN_HASH_ENTRY_STRUCT *thread_pawn_table = pawn_hash_table; //Shared table unless the thread allocated its own
 
 //Stores an entry in the table
 void Add_Pawn_Hash_Entry(int score, U64 hash)
 {
-	int hash_index = hash & hash_size;
+	int hash_index = hash & (hash_size - 1);
 
-	pawn_hash_table[hash_index].hash = hash;
-	pawn_hash_table[hash_index].score = score;
+	U64 data = (unsigned int)score;
+
+	thread_pawn_table[hash_index].hash = hash ^ data;
+	thread_pawn_table[hash_index].data = data;
 }
 
 //Gets an entry from the table
 int Get_Pawn_Hash_Entry(U64 hash)
 {
-	int hash_index = hash & hash_size;
-	if (pawn_hash_table[hash_index].hash == hash) return pawn_hash_table[hash_index].score;
+	int hash_index = hash & (hash_size - 1);
+	U64 data = thread_pawn_table[hash_index].data; //Read once, other threads may be writing this entry
+
+	if ((thread_pawn_table[hash_index].hash ^ data) == hash) return (int)(unsigned int)data;
 
 	return INVALID;
 }
@@ -36,4 +41,18 @@ int Get_Pawn_Hash_Entry(U64 hash)
 void Clear_Pawn_Hash_Table(void)
 {
 	memset(pawn_hash_table, 0, sizeof(pawn_hash_table));
+}
+
+//Gives the calling thread its own cleared table, so its scores do not depend on other threads
+void Alloc_Thread_Pawn_Hash_Table(void)
+{
+	Free_Thread_Pawn_Hash_Table();
+	thread_pawn_table = new PAWN_HASH_ENTRY_STRUCT[hash_size]();
+}
+
+//Returns the calling thread to the shared table
+void Free_Thread_Pawn_Hash_Table(void)
+{
+	if (thread_pawn_table != pawn_hash_table) delete[] thread_pawn_table;
+	thread_pawn_table = pawn_hash_table;
 }
\ No newline at end of file
@@ -6,46 +6,15 @@
 
 using namespace std;
 
-//Gets pv line by moving through hash table
-void Get_PV_Line(int depth, PV_LIST_STRUCT *pv_list, BOARD_STRUCT *board)
+//Sets a pv line to move followed by the line of the child node it leads to
+void Update_PV_Line(int move, PV_LIST_STRUCT *pv, PV_LIST_STRUCT *child_pv)
 {
-	HASH_ENTRY_STRUCT hash_entry;
-	int valid = 0;
-	
-	Clear_PV_List(pv_list);
-
-	Get_Hash_Entry(board->hash_key, 0, 0, 0, board->hply, &hash_entry.move);
-	int move = hash_entry.move;
-	int count = 0;
-
-	while ((move != 0) && (count < depth)) {
-
-		ASSERT(count < MAX_SEARCH_DEPTH);
-
-		if (Make_Move(move, board))
-		{
-			pv_list->list[count].move = move;
-			count++;
-		}
-		else {
-			break;
-		}
-
-		//Stop after 3-fold rep, 50 move, or material draw detected
-		if (Is_Threefold_Repetition(board) || board->move_counter >= 100 || Is_Material_Draw(board)) break;
-
-		//Get next hash move
-		move = 0;
-		Get_Hash_Entry(board->hash_key, 0, 0, 0, board->hply, &move);
-		
-	}
-
-	while (board->hply > 0) {
-		Take_Move(board);
+	pv->list[0].move = move;
+	for (int i = 0; i < child_pv->num; i++)
+	{
+		pv->list[i + 1].move = child_pv->list[i].move;
 	}
-
-	pv_list->num = count;
-
+	pv->num = child_pv->num + 1;
 }
 
 //Empties a PV list
@@ -62,7 +31,7 @@ void Clear_PV_List(PV_LIST_STRUCT *pv)
 	pv->num = 0;
 }
 
-//Finds pv move in list, returns 0 if not found
+//Finds compact pv move in list, returns 0 if not found
 int Find_PV_Move(int move_num, MOVE_LIST_STRUCT *move_list)
 {
 	int index;
@@ -70,7 +39,7 @@ int Find_PV_Move(int move_num, MOVE_LIST_STRUCT *move_list)
 
 	for (index = 0; index < move_list->num; index++)
 	{
-		if (move_list->list[index].move == move_num) //if move matches pv move
+		if (TO_COMPACT_MOVE(move_list->list[index].move) == move_num) //if move matches pv move
 		{
 			move_list->list[index].score = PV_SCORE; //Set mvoe score to PV_SCORE
 			return 1;
@@ -6,28 +6,42 @@
 #include "time.h"
 #include "windows.h"
 #include "crtdbg.h"
+#include <thread>
+#include <chrono>
 
 using namespace std;
 
 
-//Searches a given position using board and search info 
+//Searches a given position using board and search info, info must be cleared by the caller
 int Search_Position(BOARD_STRUCT *board, SEARCH_INFO_STRUCT *info)
 {
 	int currentDepth, score;
 	int previous_node_count = 0;
 	int depth_start_time;
 	int window_low, window_high;
-	int prev_score = 0;
+	int prev_scores[MAX_MOVE_LIST_LENGTH] = { 0 }; //Score of each multipv line in the previous iteration
+	int line_prev_score;
+	int num_lines;
+	int best_score = 0; //Score of the first line
+	int score_drop;
+	int prev_best_move = 0;
+	int stable_iterations = 0; //Iterations without a best move change
+	int best_move_effort = 0; //Percent of iteration nodes spent on the best move
 	PV_LIST_STRUCT pv_list;
-	MOVE_STRUCT best_move;
+	MOVE_STRUCT best_move = { 0, 0 };
+	MOVE_STRUCT ponder_move = { 0, 0 };
 
 	Clear_PV_List(&pv_list);
-	Clear_Search_Info(info);
 
 	board->hply = 0;
+	if (use_nnue) NN_Refresh_Accumulator(board); //Accumulators are not updated while the classical eval is used
+	Init_Root_Moves(&info->root_moves, board);
+	tb_cardinality = use_tb_probe ? TB_Root_Probe(board, info) : 0; //Root moves that lose a tablebase result are removed
+	if (info->root_moves.num > 0) best_move.move = info->root_moves.list[0].move; //Played if stopped before the first iteration ends
 	score = 0;
 
 	Clear_History_Data(board);
+	Start_Helpers(board, info);
 
 	for (currentDepth = 1; currentDepth <= info->depth; currentDepth++)
 	{		
@@ -37,59 +51,91 @@ int Search_Position(BOARD_STRUCT *board, SEARCH_INFO_STRUCT *info)
 
 		depth_start_time = Get_Time_Ms();
 
-		/***** Aspiration Windows *****/
-		if (use_aspiration_window)
+		/***** Multi PV *****/
+		/* Each line searches the root moves that earlier lines did not choose */
+		num_lines = max(1, min(multi_pv, info->root_moves.num));
+		for (info->pv_index = 0; info->pv_index < num_lines; info->pv_index++)
 		{
-			window_low = 0;
-			window_high = 0;
+			line_prev_score = prev_scores[info->pv_index];
 
-			while (true)
+			/***** Aspiration Windows *****/
+			if (use_aspiration_window)
 			{
-				score = Alpha_Beta(prev_score - aspiration_windows[window_low], prev_score + aspiration_windows[window_high], currentDepth, PV, DO_NULL, board, info);
-				if (score <= prev_score - aspiration_windows[window_low]) //Fail low
-				{
-					window_low++;
-				}
-				else if (score >= prev_score + aspiration_windows[window_high]) //Fail High
-				{
-					window_high++;
-				}
-				else //within window
+				window_low = 0;
+				window_high = 0;
+
+				while (true)
 				{
-					break;
+					score = Alpha_Beta<ROOT>(line_prev_score - aspiration_windows[window_low], line_prev_score + aspiration_windows[window_high], currentDepth, DO_NULL, board, info);
+					if (score <= line_prev_score - aspiration_windows[window_low]) //Fail low
+					{
+						window_low++;
+					}
+					else if (score >= line_prev_score + aspiration_windows[window_high]) //Fail High
+					{
+						window_high++;
+					}
+					else //within window
+					{
+						break;
+					}
 				}
 			}
+			else //No aspiration window
+			{
+				score = Alpha_Beta<ROOT>(-INF, INF, currentDepth, DO_NULL, board, info);
+			}
+
+			if (info->stopped == 1) {
+				break;
+			}
+			prev_scores[info->pv_index] = score;
+
+			/***** Get PV Line *****/
+			/* The root line is collected during search, a root that failed low only has its move */
+			Sort_Root_Moves(&info->root_moves, info->pv_index); //Move for this line first
+			pv_list = board->pv_table[0];
+			if (pv_list.num == 0 && info->root_moves.num > info->pv_index)
+			{
+				pv_list.list[0].move = info->root_moves.list[info->pv_index].move;
+				pv_list.num = 1;
+			}
+			if (info->pv_index == 0)
+			{
+				score_drop = line_prev_score - score;
+				best_score = score;
+				if (pv_list.list[0].move != 0) Copy_Move(&pv_list.list[0], &best_move); //Store best move found
+				ponder_move.move = (pv_list.num > 1) ? pv_list.list[1].move : 0; //Expected reply
+			}
+
+			//Print search info
+			printf("info ");
+			if (multi_pv > 1) printf("multipv %d ", info->pv_index + 1);
+			if (IS_MATE(score))
+			{
+				printf("score mate %d", (score > 0) ? (MATE_SCORE - score) / 2 + 1 : -(MATE_SCORE + score) / 2 - 1);
+			}
+			else
+			{
+				printf("score cp %d", score);
+			}
+		
+			//Remaining info
+				printf(" depth %d seldepth %d nodes %ld time %d nps %d tbhits %ld ",
+					currentDepth, info->max_depth, info->nodes, Get_Time_Ms() - info->start_time, (int)(info->nodes / ((Get_Time_Ms() - depth_start_time + 1) / 1000.0)), info->tb_hits);
+
+			//Print current pv line
+			printf("pv ");
+			Print_PV_List(&pv_list);
+			printf("\n\n");
 		}
-		else //No aspiration window
-		{
-			//score = Alpha_Beta(-INF, INF, currentDepth, PV, board, info);
-			score = Search_Root(-INF, INF, currentDepth, board, info);
-		}
+
+		info->total_nodes += info->nodes;
 
 		if (info->stopped == 1) {
 			break;
 		}
-		prev_score = score;
 
-		/***** Get PV Line *****/
-		Get_PV_Line(currentDepth, &pv_list, board);
-		if (pv_list.list[0].move != 0) Copy_Move(&pv_list.list[0], &best_move); //Store best move found
-
-		//Print search info
-		printf("info ");
-		if (IS_MATE(score))
-		{
-			printf("score mate %d", (score > 0) ? (MATE_SCORE - score) / 2 + 1 : -(MATE_SCORE + score) / 2 - 1);
-		}
-		else
-		{
-			printf("score cp %d", score);
-		}
-		
-		//Remaining info
-			printf(" depth %d seldepth %d nodes %ld time %d nps %d ",
-				currentDepth, info->max_depth, info->nodes, Get_Time_Ms() - info->start_time, (int)(info->nodes / ((Get_Time_Ms() - depth_start_time + 1) / 1000.0)));
-		
 		//Print branching factor
 		if (previous_node_count != 0)
 		{
@@ -98,154 +144,51 @@ int Search_Position(BOARD_STRUCT *board, SEARCH_INFO_STRUCT *info)
 		}
 		previous_node_count = info->nodes;
 
-		//Print current pv line
-		printf("pv ");
-		Print_PV_List(&pv_list);
-		printf("\n\n");
+		/***** Time Management *****/
+		Check_Ponderhit(info);
+		if (best_move.move == prev_best_move) stable_iterations++;
+		else stable_iterations = 0;
+		prev_best_move = best_move.move;
 
-		//End if time is one third gone because next depth is unlikely to finish
-		//if (info->time_set && info->end_early && (Get_Time_Ms() - info->start_time) >= ((info->stop_time - info->start_time) / 3.0)) break;
+		Sort_Root_Moves(&info->root_moves, 0); //Best move first
+		if (info->root_moves.num > 0) best_move_effort = (int)(info->root_moves.list[0].nodes / (info->nodes / 100 + 1));
 
-		//End search if mate found and full pv shown
-		if (IS_MATE(score) && (currentDepth >= ((score > 0) ? MATE_SCORE - score : MATE_SCORE + score))) break; 
-		
-	}
-
-	printf("bestmove %s\n", UCI_Move_String(&best_move));
-	
-	info->age++;
-	Age_History_Data(board);
-
-	return 1;
-}
+		//Do not start another iteration once the optimum time is used
+		if (info->time_set && info->end_early && !info->pondering && Soft_Time_Up(stable_iterations, score_drop, best_move_effort, info)) break;
 
-//Root node search
-int Search_Root(int alpha, int beta, int depth, BOARD_STRUCT *board, SEARCH_INFO_STRUCT *info)
-{
-	int move;
-	int best_score = -INF;
-	int best_move = 0;
-	int score = -MATE_SCORE; //Set in case no moves are available
-	MOVE_LIST_STRUCT move_list;
-	int current_move;
-	int current_move_score;
-	HASH_ENTRY_STRUCT hash_entry;
-	hash_entry.move = 0;
-	int valid = 0;
-	int best_move_index = 0;
-
-	info->nodes++;
-	//Check for timeout
-	if ((info->nodes & 4095) == 0) //every 4096 nodes
-	{
-		if ((info->time_set) && (Get_Time_Ms() > info->stop_time - 40)) //Could be reduced to 10 ms
-		{
-			info->stopped = 1;
-			return 0;
-		}
-		ReadInput(info); //Check for input
+		//End search if mate found and full pv shown, other multipv lines still need depth
+		if (multi_pv == 1 && IS_MATE(best_score) && (currentDepth >= ((best_score > 0) ? MATE_SCORE - best_score : MATE_SCORE + best_score))) break; 
+		
 	}
 
-	/***** Check hash table *****/
-	info->hash_probes++;
-	int value = Get_Hash_Entry(board->hash_key, alpha, beta, depth, board->hply, &hash_entry.move);
-	if (hash_entry.move != 0) info->hash_hits++; //Count hash hit as long as a move if found
-
-	/***** Move generation *****/
-	Generate_Moves(board, &move_list);
+	Stop_Helpers();
 
-	if (!Find_PV_Move(hash_entry.move, &move_list)) //If hash move not found
+	//A ponder search can only report its move after ponderhit or stop
+	while (info->pondering && !info->ponderhit && !info->stopped)
 	{
-		/***** Internal Iterative Deepening *****/
-		/* This funtion is almost never called, but it's an insurance measure just in case*/
-		if (depth >= 5)
-		{
-			Internal_Iterative_Deepening(alpha, beta, depth, &move_list, board, info);
-		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
 	}
 
-
-	/***** Search *****/
-	for (move = 0; move < move_list.num; move++) //For all moves in list
-	{
-		/***** Get best move *****/
-		Get_Next_Move(move, &move_list);//Moves next move into move_index position
-		current_move = move_list.list[move].move;
-		current_move_score = move_list.list[move].score;
-
-		if (current_move == 0) break; //End if no moves are available
-
-		//if (current_move == hash_entry.move) continue;
-
-		if (!Make_Move(current_move, board)) continue;//If move is unsuccessful, try next move
-		
-		/***** Principal Variation Search *****/
-		if (move == 0) //If first move, use full window
-		{
-			score = -Alpha_Beta(-beta, -alpha, depth - 1, PV, DO_NULL, board, info);
-		}
-		else //If not first move
-		{
-			score = -Alpha_Beta(-alpha - 1, -alpha, depth - 1, NOT_PV, DO_NULL, board, info); //Full window search
-			if (score > alpha)
-			{
-				score = -Alpha_Beta(-beta, -alpha, depth - 1, PV, DO_NULL, board, info);
-			}
-		}
-
-		Take_Move(board);
-
-		//Check if search ended while searching
-		if (info->stopped)
-		{
-			return 0;
-		}
-
-		//Update beta, storing hash entry if cutoff is found
-		if (score >= beta)
-		{
-			//Store hash entry
-			Fill_Hash_Entry(info->age, depth, score, HASH_LOWER, board->hash_key, current_move, &hash_entry);
-			Store_Hash_Entry(&hash_entry, board->hply, info);
-
-			//Update best move index
-			info->beta_cutoff_index[move]++;
-
-			//if move is not a capture or promotion
-			if (current_move_score <= KILLER_MOVE_SCORE)
-			{
-				Add_Killer_Move(current_move, board); //Store killer move
-				//Add_History_Move(current_move, board); //Store move in history array
-			}
-			return score; //Beta cutoff
-		}
-		//Update best score and best move for hash entry later
-		if (score > best_score)
-		{
-			//Update alpha
-			if (score > alpha)
-			{
-				alpha = score;
-			}
-			best_score = score;
-			best_move_index = move;
-			best_move = current_move;
-		}
-	} //End looping through all moves
-
-	//Store hash entry
-	Fill_Hash_Entry(info->age, depth, best_score, HASH_EXACT, board->hash_key, best_move, &hash_entry);
-	Store_Hash_Entry(&hash_entry, board->hply, info);
+	if (best_move.move != 0) printf("bestmove %s", UCI_Move_String(&best_move));
+	else printf("bestmove 0000"); //No legal moves
+	if (ponder_move.move != 0) printf(" ponder %s", UCI_Move_String(&ponder_move));
+	printf("\n");
 	
-	//Update best_index
-	info->best_index[best_move_index]++;
+	info->age++;
+	Age_History_Data(board);
 
-	return best_score;
+	return 1;
 }
 
 //Alpha beta implementation in negamax search
-int Alpha_Beta(int alpha, int beta, int depth, PV_ENUM is_pv, NULL_ENUM do_null, BOARD_STRUCT *board, SEARCH_INFO_STRUCT *info)
+//node_type is a template parameter so that pv and root logic compiles out of non-pv nodes
+template <PV_ENUM node_type>
+int Alpha_Beta(int alpha, int beta, int depth, NULL_ENUM do_null, BOARD_STRUCT *board, SEARCH_INFO_STRUCT *info)
 {
+	const int pv_node = (node_type != NOT_PV); //Root is also a pv node
+	const int root_node = (node_type == ROOT);
+	const PV_ENUM child_type = (node_type == NOT_PV) ? NOT_PV : PV; //Type of first child searched
+
 	int move;
 	int moves_searched = 0; //Number of legal moves searched (not futility pruned)
 	int moves_made = 0; //Number of legal moves
@@ -255,47 +198,55 @@ int Alpha_Beta(int alpha, int beta, int depth, PV_ENUM is_pv, NULL_ENUM do_null,
 	int score = -MATE_SCORE; //Set in case no moves are available
 	int mate = 1; //If no legal moves are found
 	int f_prune_allowed = 0; //If futility pruning is allowed at this node
+	int lazy_bound; //Set by Lazy_Evaluate, futility only needs the bound
 	MOVE_LIST_STRUCT move_list;
 	int current_move;
 	int current_move_score;
 	HASH_ENTRY_STRUCT hash_entry;
-	hash_entry.move = 0;
+	int hash_move = 0; //Compact move from hash table
 	int valid = 0;
 	int checking_move = 0;
 	int best_move_index = 0;
 	int reduction = 0;
 
+	/***** Hoisted Settings *****/
+	/* Read once per node instead of once per move */
+	const int lmr_allowed = !root_node && use_late_move_reduction && (!pv_node || use_lmr_in_pv);
+	const int research_allowed = pv_node || !only_research_in_pv;
+
 	info->nodes++;
-	//Check for timeout
+	//Check for timeout or node limit
 	if ((info->nodes & 4095) == 0) //every 4096 nodes
 	{
-		if ((info->time_set) && (Get_Time_Ms() > info->stop_time - 40)) //Could be reduced to 10 ms
+		if (Search_Limit_Reached(info))
 		{
 			info->stopped = 1;
 			return 0;
 		}
-		ReadInput(info); //Check for input
 	}
 
-	/***** Check for max depth *****/
-	if (board->hply > info->max_depth) info->max_depth = board->hply;
-	if (board->hply >= MAX_SEARCH_DEPTH)
+	if (!root_node)
 	{
-		return Evaluate_Board(board);
-	}
+		/***** Check for max depth *****/
+		if (board->hply > info->max_depth) info->max_depth = board->hply;
+		if (board->hply >= MAX_SEARCH_DEPTH)
+		{
+			return Evaluate_Board(board);
+		}
 
-	/***** Mate Distance Pruning *****/
-	int mate_value = MATE_SCORE - board->hply;
-	if (alpha < -mate_value) alpha = -mate_value;
-	if (beta > mate_value - 1) beta = mate_value - 1;
-	if (alpha >= beta) return alpha;
+		/***** Mate Distance Pruning *****/
+		int mate_value = MATE_SCORE - board->hply;
+		if (alpha < -mate_value) alpha = -mate_value;
+		if (beta > mate_value - 1) beta = mate_value - 1;
+		if (alpha >= beta) return alpha;
 
-	/***** Draw Detection *****/
-	if (board->move_counter >= 100 || Is_Material_Draw(board) || (board->hply && Is_Repetition(board)))	return 0;
+		/***** Draw Detection *****/
+		if (board->move_counter >= 100 || Is_Material_Draw(board) || (board->hply && Is_Repetition(board)))	return 0;
+	}
 
 	/***** Check Test *****/
 	int in_check = In_Check(board->side, board);
-	if (in_check) depth++;
+	if (in_check && !root_node) depth++;
 
 	/***** Leaf Node Response *****/
 	//Start quiescent search at depth 0
@@ -306,13 +257,30 @@ int Alpha_Beta(int alpha, int beta, int depth, PV_ENUM is_pv, NULL_ENUM do_null,
 
 	/***** Check hash table *****/
 	info->hash_probes++;
-	int value = Get_Hash_Entry(board->hash_key, alpha, beta, depth, board->hply, &hash_entry.move);
-	if (hash_entry.move != 0) info->hash_hits++; //Count hash hit as long as a move if found
-	if (value != INVALID) 
+	int value = Get_Hash_Entry(board->hash_key, alpha, beta, depth, board->hply, &hash_move);
+	if (hash_move != 0) info->hash_hits++; //Count hash hit as long as a move if found
+	if (value != INVALID && !pv_node) //Pv nodes always search so their line can be collected
+	{
+		return value; 
+	}
+
+	/***** Tablebase Probe *****/
+	/* Only right after a capture or pawn move, other positions were probed earlier in the line */
+	if (!root_node
+	&& tb_cardinality
+	&& board->move_counter == 0
+	&& !board->castle_rights
+	&& count_1s(board->side_bitboards[BOTH]) <= tb_cardinality)
 	{
-		if (!is_pv || (value > alpha && value < beta)) //Only return exact values in pv line
+		int found;
+		int wdl = TB_Probe_WDL(board, &found);
+		if (found)
 		{
-				return value; 
+			info->tb_hits++;
+			value = (wdl > 1) ? TB_WIN_SCORE - board->hply : (wdl < -1) ? -TB_WIN_SCORE + board->hply : 0; //Results saved by the 50 move rule are draws
+			Fill_Hash_Entry(info->age, min(depth + 6, MAX_SEARCH_DEPTH), value, HASH_EXACT, board->hash_key, 0, &hash_entry);
+			Store_Hash_Entry(&hash_entry, board->hply, info);
+			return value;
 		}
 	}
 	
@@ -346,9 +314,9 @@ int Alpha_Beta(int alpha, int beta, int depth, PV_ENUM is_pv, NULL_ENUM do_null,
 	*/
 
 	/***** Null Move *****/
-	if (depth >= 4 
+	if (!pv_node
+	&& depth >= 4 
 	&& do_null
-	&& !is_pv 
 	&& board->hply 
 	&& !in_check 
 	&& (board->big_material[board->side] >= null_move_mat))
@@ -358,7 +326,7 @@ int Alpha_Beta(int alpha, int beta, int depth, PV_ENUM is_pv, NULL_ENUM do_null,
 
 
 		Make_Null_Move(board);
-		score = -Alpha_Beta(-beta, -beta + 1, depth - 1 - R, NOT_PV, DONT_DO_NULL, board, info); //Subtract an additional 2 ply from depth
+		score = -Alpha_Beta<NOT_PV>(-beta, -beta + 1, depth - 1 - R, DONT_DO_NULL, board, info); //Subtract an additional 2 ply from depth
 		Take_Null_Move(board);
 
 		if (score >= beta && !IS_MATE(score)) return score;
@@ -366,53 +334,127 @@ int Alpha_Beta(int alpha, int beta, int depth, PV_ENUM is_pv, NULL_ENUM do_null,
 
 	/***** Futility Pruning *****/
 	/* Here we determine if this node is elegible for futility pruning */
-	if (depth <= 2
+	if (!pv_node
+		&& depth <= 2
 		&& use_futility
-		&& !is_pv
 		&& !in_check
 		&& !IS_MATE(alpha) //Not searching for a mate
-		&& (Evaluate_Board(board) + futility_margins[depth] <= alpha))
+		&& (Lazy_Evaluate(alpha - futility_margins[depth], alpha - futility_margins[depth] + 1, board, &lazy_bound) + futility_margins[depth] <= alpha))
 		f_prune_allowed = 1;
 
 	/***** Move generation *****/
-	Generate_Moves(board, &move_list);
-	
-	if (!Find_PV_Move(hash_entry.move, &move_list)) //If hash move not found
+	if (root_node) //Root moves keep their order and node counts between searches
+	{
+		ROOT_MOVE_LIST_STRUCT *root_moves = &info->root_moves;
+
+		//Moves already chosen by earlier multipv lines are excluded
+		Sort_Root_Moves(root_moves, info->pv_index);
+		move_list.num = 0;
+		for (int i = info->pv_index; i < root_moves->num; i++)
+		{
+			root_moves->list[i].prev_score = root_moves->list[i].score;
+			root_moves->list[i].score = -INF;
+			move_list.list[move_list.num].move = root_moves->list[i].move;
+			move_list.list[move_list.num].score = root_moves->list[i].order_score;
+			move_list.num++;
+		}
+	}
+	else
 	{
-		/***** Internal Iterative Deepening *****/
-		/* This funtion is almost never called, but it's an insurance measure just in case*/
-		if (is_pv
-			&& depth >= 5
-			&& do_null)
+		Generate_Moves(board, &move_list);
+		
+		if (!Find_PV_Move(hash_move, &move_list)) //If hash move not found
 		{
-			Internal_Iterative_Deepening(alpha, beta, depth, &move_list, board, info);
+			/***** Internal Iterative Deepening *****/
+			/* This funtion is almost never called, but it's an insurance measure just in case*/
+			if (pv_node
+				&& depth >= 5
+				&& do_null)
+			{
+				if (iid_mode == IID_SWEEP)
+				{
+					Internal_Iterative_Deepening(alpha, beta, depth, &move_list, board, info);
+				}
+				else if (iid_mode == IID_SHALLOW) //Search this node at half depth to seed the hash move
+				{
+					Alpha_Beta<node_type>(alpha, beta, depth / 2, DO_NULL, board, info);
+					if (SEARCH_ABORTED(info)) return 0;
+
+					Get_Hash_Entry(board->hash_key, alpha, beta, depth, board->hply, &hash_move);
+					Find_PV_Move(hash_move, &move_list);
+				}
+				else //Internal iterative reduction
+				{
+					depth--;
+				}
+			}
 		}
+		Find_Best_Recapture(&move_list, board);
 	}
-	Find_Best_Recapture(&move_list, board);
+
+	if (pv_node) board->pv_table[board->hply].num = 0; //Filled when a move raises alpha
 
 	/***** Search *****/
 	for (move = 0; move < move_list.num; move++) //For all moves in list
 	{
+		/***** Young Brothers Wait *****/
+		/* Once one move is searched, the rest of a non-pv node can be shared with idle threads */
+		if (!pv_node && moves_searched && depth >= SPLIT_MIN_DEPTH && Can_Split(info))
+		{
+			score = Split(alpha, beta, depth, in_check, move, moves_made, &move_list, &current_move, &current_move_score, board, info);
+
+			if (SEARCH_ABORTED(info)) return 0;
+
+			if (score >= beta)
+			{
+				Fill_Hash_Entry(info->age, depth, score, HASH_LOWER, board->hash_key, current_move, &hash_entry);
+				Store_Hash_Entry(&hash_entry, board->hply, info);
+
+				if (current_move_score <= KILLER_MOVE_SCORE)
+				{
+					Add_Killer_Move(current_move, board);
+					Add_History_Move(current_move, depth, board);
+				}
+				return score; //Beta cutoff
+			}
+			if (score > best_score)
+			{
+				best_score = score;
+				best_move = current_move;
+			}
+			break; //All moves have been searched
+		}
+
 		/***** Get best move *****/
-		Get_Next_Move(move, &move_list);//Moves next move into move_index position
+		if (!root_node) Get_Next_Move(move, &move_list);//Moves next move into move_index position, root list is already ordered
 		current_move = move_list.list[move].move;
 		current_move_score = move_list.list[move].score;
+		const long move_start_nodes = info->nodes;
 
 		if (current_move == 0) break; //End if no moves are available
 
 		//if (current_move == hash_entry.move) continue;
 
+		//Report current root move once the search is long enough for a gui to show it
+		if (root_node && info->thread_index == 0 && Get_Time_Ms() - info->start_time > CURRMOVE_TIME)
+		{
+			printf("info depth %d currmove %s currmovenumber %d\n", depth, UCI_Move_String(&move_list.list[move]), info->pv_index + move + 1);
+		}
+
 		if (!Make_Move(current_move, board)) continue;//If move is unsuccessful, try next move
 		
+		if (pv_node) board->pv_table[board->hply].num = 0; //Child line stays empty unless the child is a pv node that raises alpha
+
 		mate = 0; //A move has been made
 		moves_made++;
 
 		//See if current move leads to check, important for pruning and reductions
-		if((f_prune_allowed || moves_made >= LATE_MOVE_NUM) && CAN_REDUCE(current_move)) checking_move = In_Check(board->side, board);
+		if((f_prune_allowed || (lmr_allowed && moves_made >= LATE_MOVE_NUM)) && CAN_REDUCE(current_move)) checking_move = In_Check(board->side, board);
 		else checking_move = 0;
 
 		/***** Futility Pruning *****/
-		if (f_prune_allowed
+		if (!pv_node
+			&& f_prune_allowed
 			&&  !IS_CAPTURE(current_move)
 			&& !IS_PROMOTION(current_move)
 			&& !checking_move) 
@@ -424,7 +466,7 @@ int Alpha_Beta(int alpha, int beta, int depth, PV_ENUM is_pv, NULL_ENUM do_null,
 			}
 			else //Razoring
 			{
-				score = -Alpha_Beta(-alpha - 1, -alpha, 1, NOT_PV, DO_NULL, board, info); //Null window search at depth 1
+				score = -Alpha_Beta<NOT_PV>(-alpha - 1, -alpha, 1, DO_NULL, board, info); //Null window search at depth 1
 				if (score <= alpha)
 				{
 					Take_Move(board);
@@ -438,34 +480,27 @@ int Alpha_Beta(int alpha, int beta, int depth, PV_ENUM is_pv, NULL_ENUM do_null,
 		/***** Principal Variation Search *****/
 		if (move == 0) //If first move, use full window
 		{
-			score = -Alpha_Beta(-beta, -alpha, depth - 1, is_pv, DO_NULL, board, info);
+			score = -Alpha_Beta<child_type>(-beta, -alpha, depth - 1, DO_NULL, board, info);
 		}
 		else //If not first move
 		{
 			/***** Late move reduction *****/
 			/* Does a reduced search if the move is eligible, otherwise goes straight into PVS search */
 			/* Moves that raise alpha are re-searched in PVS */
-			if (moves_made >= LATE_MOVE_NUM
-				&& use_late_move_reduction
+			if (lmr_allowed
+				&& moves_made >= LATE_MOVE_NUM
 				&& !in_check
-				&& (!is_pv || use_lmr_in_pv)
 				&& CAN_REDUCE(current_move)
 				&& depth >= REDUCTION_LIMIT
 				&& !IS_KILLER(move_list.list[move].score)
 				&& !checking_move)
 			{
-				if (use_extra_lmr)
-				{
-					double reduction_temp = sqrt(depth * lmr_depth_mod) + sqrt(move * lmr_move_mod);
-					if (is_pv) reduction_temp *= lmr_pv_mod;
-					reduction = (int)reduction_temp; //Floor
-				}
-				else reduction = 1;
+				reduction = lmr_reductions[min(depth, MAX_SEARCH_DEPTH - 1)][move][pv_node];
 
 				int new_depth = max(1,depth - reduction - 1);
 
 				//Null Window search
-				score = -Alpha_Beta(-alpha - 1, -alpha, new_depth, NOT_PV, DO_NULL, board, info); 
+				score = -Alpha_Beta<NOT_PV>(-alpha - 1, -alpha, new_depth, DO_NULL, board, info); 
 			}
 			else
 			{
@@ -476,12 +511,12 @@ int Alpha_Beta(int alpha, int beta, int depth, PV_ENUM is_pv, NULL_ENUM do_null,
 			if (score > alpha) //Continue if reduced search is improvement
 			{
 				//Look for refutation in null window
-				score = -Alpha_Beta(-alpha - 1, -alpha, depth - 1, NOT_PV, DO_NULL, board, info); //Null window search
+				score = -Alpha_Beta<NOT_PV>(-alpha - 1, -alpha, depth - 1, DO_NULL, board, info); //Null window search
 
 				//If move improves alpha but does not cause a cutoff, and if not in a null search already
-				if ((is_pv || !only_research_in_pv) && alpha < score && beta > score && (beta - alpha > 1))
+				if (research_allowed && alpha < score && beta > score && (beta - alpha > 1))
 				{
-					score = -Alpha_Beta(-beta, -alpha, depth - 1, PV, DO_NULL, board, info);
+					score = -Alpha_Beta<PV>(-beta, -alpha, depth - 1, DO_NULL, board, info);
 				}
 			
 			}
@@ -490,11 +525,19 @@ int Alpha_Beta(int alpha, int beta, int depth, PV_ENUM is_pv, NULL_ENUM do_null,
 		Take_Move(board);
 
 		//Check if search ended while searching
-		if (info->stopped)
+		if (SEARCH_ABORTED(info))
 		{
 			return 0;
 		}
 
+		//Root move data used for ordering the next search
+		if (root_node)
+		{
+			ROOT_MOVE_STRUCT *root_move = &info->root_moves.list[info->pv_index + move];
+			root_move->nodes = info->nodes - move_start_nodes;
+			if (score > alpha) root_move->score = score; //Scores at or below alpha are only bounds
+		}
+
 		//Update beta, storing hash entry if cutoff is found
 		if (score >= beta)
 		{
@@ -520,6 +563,7 @@ int Alpha_Beta(int alpha, int beta, int depth, PV_ENUM is_pv, NULL_ENUM do_null,
 			if (score > alpha)
 			{
 				alpha = score;
+				if (pv_node) Update_PV_Line(current_move, &board->pv_table[board->hply], &board->pv_table[board->hply + 1]);
 			}
 			best_score = score;
 			best_move_index = move;
@@ -568,25 +612,123 @@ int Alpha_Beta(int alpha, int beta, int depth, PV_ENUM is_pv, NULL_ENUM do_null,
 	return best_score;
 }
 
+//Explicit instantiations for each node type
+template int Alpha_Beta<NOT_PV>(int alpha, int beta, int depth, NULL_ENUM do_null, BOARD_STRUCT *board, SEARCH_INFO_STRUCT *info);
+template int Alpha_Beta<PV>(int alpha, int beta, int depth, NULL_ENUM do_null, BOARD_STRUCT *board, SEARCH_INFO_STRUCT *info);
+template int Alpha_Beta<ROOT>(int alpha, int beta, int depth, NULL_ENUM do_null, BOARD_STRUCT *board, SEARCH_INFO_STRUCT *info);
+
+//Searches moves from a split point until none are left or the split point is cut off
+//Runs on the owner and on every helper that joins, board is the thread's own copy of the split node
+//Split points are only opened at non-pv nodes, so every move gets the same null window search as in Alpha_Beta
+void Search_Split_Point(SPLIT_POINT_STRUCT *sp, BOARD_STRUCT *board, SEARCH_INFO_STRUCT *info)
+{
+	const int lmr_allowed = use_late_move_reduction;
+	SPLIT_POINT_STRUCT *parent = info->split_point;
+	int move;
+	int current_move;
+	int current_move_score;
+	int moves_made;
+	int alpha;
+	int score;
+	int checking_move;
+
+	info->split_point = sp;
+
+	while (!SEARCH_ABORTED(info))
+	{
+		/***** Get best move *****/
+		/* The list is shared, so moves are ordered and handed out under the lock */
+		sp->lock.lock();
+		move = sp->next_move;
+		current_move = 0;
+		if (move < sp->move_list.num)
+		{
+			Get_Next_Move(move, &sp->move_list);
+			current_move = sp->move_list.list[move].move;
+			current_move_score = sp->move_list.list[move].score;
+			sp->next_move++;
+		}
+		alpha = sp->alpha;
+		sp->lock.unlock();
+
+		if (current_move == 0) break; //No moves left
+
+		if (!Make_Move(current_move, board)) continue;
+
+		moves_made = ++sp->moves_made;
+
+		if (lmr_allowed && moves_made >= LATE_MOVE_NUM && CAN_REDUCE(current_move)) checking_move = In_Check(board->side, board);
+		else checking_move = 0;
+
+		/***** Late move reduction *****/
+		if (lmr_allowed
+			&& moves_made >= LATE_MOVE_NUM
+			&& !sp->in_check
+			&& CAN_REDUCE(current_move)
+			&& sp->depth >= REDUCTION_LIMIT
+			&& !IS_KILLER(current_move_score)
+			&& !checking_move)
+		{
+			int new_depth = max(1, sp->depth - lmr_reductions[min(sp->depth, MAX_SEARCH_DEPTH - 1)][move][NOT_PV] - 1);
+			score = -Alpha_Beta<NOT_PV>(-alpha - 1, -alpha, new_depth, DO_NULL, board, info);
+		}
+		else
+		{
+			score = alpha + 1;
+		}
+
+		/***** Principal Variation Search *****/
+		if (score > alpha)
+		{
+			score = -Alpha_Beta<NOT_PV>(-alpha - 1, -alpha, sp->depth - 1, DO_NULL, board, info);
+		}
+
+		Take_Move(board);
+
+		if (SEARCH_ABORTED(info)) break; //Score is not valid
+
+		sp->lock.lock();
+		if (score > sp->best_score)
+		{
+			sp->best_score = score;
+			sp->best_move = current_move;
+			sp->best_move_score = current_move_score;
+			if (score > sp->alpha) sp->alpha = score;
+			if (score >= sp->beta) sp->cutoff = 1; //Other threads stop searching this node
+		}
+		sp->lock.unlock();
+	}
+
+	info->split_point = parent;
+}
+
 //Quiescent search to find positions suitable for evaluation
 int Quiescent_Search(int alpha, int beta, BOARD_STRUCT *board, SEARCH_INFO_STRUCT *info)
 {
 	int move;
 	MOVE_LIST_STRUCT move_list;
 	int next_move;
-	int score = Evaluate_Board(board);
-	int best_score = score;
+	int score;
+	int best_score;
+	int best_move = 0;
+	int alpha_orig = alpha;
+	int moves_searched = 0;
+	int stand_pat;
+	int delta_score; //Best score a capture can reach
+	int lazy_bound; //Stand pat is a bound from the lazy eval exit
+	HASH_ENTRY_STRUCT hash_entry;
+	int hash_move = 0; //Compact move from hash table
 	
 	info->nodes++;
+	info->qs_nodes++;
 
 	if ((info->nodes & 4095) == 0) //every 4096 nodes
 	{
-		if (info->time_set && (Get_Time_Ms() > info->stop_time - 40))
+		if (Search_Limit_Reached(info))
 		{
 			info->stopped = 1;
 			return 0;
 		}
-		ReadInput(info); //Check for input
 	}
 
 	//Check for max depth
@@ -598,13 +740,31 @@ int Quiescent_Search(int alpha, int beta, BOARD_STRUCT *board, SEARCH_INFO_STRUC
 	/***** Draw Detection *****/
 	//if (board->move_counter >= 100 || Is_Material_Draw(board) || (board->hply && Is_Repetition(board)))	return 0;
 
-	if (score >= beta) return score;
-	if (score > best_score) best_score = score;
-	if (score > alpha) alpha = score;
+	/***** Check hash table *****/
+	/* Any entry from the main search is deep enough to use here */
+	if (info->use_hash)
+	{
+		info->hash_probes++;
+		int value = Get_Hash_Entry(board->hash_key, alpha, beta, HASH_QS_DEPTH, board->hply, &hash_move);
+		if (hash_move != 0) info->hash_hits++;
+		if (value != INVALID) return value;
+	}
+
+	/***** Stand Pat *****/
+	/* Stand pat results are not stored, evaluating again is cheaper than a table write */
+	stand_pat = Lazy_Evaluate(alpha, beta, board, &lazy_bound);
+	if (stand_pat >= beta) return stand_pat;
+
+	//Delta scores raise best_score, so they are only built from an exact stand pat
+	if (lazy_bound && use_delta_pruning) stand_pat = Evaluate_Board(board);
+	best_score = stand_pat;
+
+	if (stand_pat > alpha) alpha = stand_pat;
 
 
 	Generate_Capture_Promote_Moves(board, &move_list);
 	if(quiescent_SEE) Set_Quiescent_SEE_Scores(&move_list, board);
+	Find_PV_Move(hash_move, &move_list); //Search best capture from hash table first
 
 	for (move = 0; move < move_list.num; move++) //For all moves in list
 	{
@@ -613,25 +773,67 @@ int Quiescent_Search(int alpha, int beta, BOARD_STRUCT *board, SEARCH_INFO_STRUC
 
 		if (next_move == 0) break; 
 
-		if (Make_Move(next_move, board)) //If move is successful
+		/***** Pruning *****/
+		//Promotions gain more than the captured piece, so they are always searched
+		if (!IS_PROMOTION(next_move))
 		{
-			score = -Quiescent_Search(-beta, -alpha,  board, info);
-			Take_Move(board);
+			//Delta pruning, skip captures that cannot raise alpha even with a margin
+			if (use_delta_pruning)
+			{
+				delta_score = stand_pat + piece_values[GET_CAPTURE(next_move)] + delta_margin;
+				if (delta_score <= alpha)
+				{
+					if (delta_score > best_score) best_score = delta_score;
+					info->delta_pruned++;
+					continue;
+				}
+			}
+
+			//SEE pruning, skip captures that lose material
+			if (use_see_pruning && Static_Exchange_Evaluation(next_move, board) < 0)
+			{
+				info->see_pruned++;
+				continue;
+			}
 		}
-		if (info->stopped)
+
+		if (!Make_Move(next_move, board)) continue; //If move is unsuccessful, try next move
+
+		score = -Quiescent_Search(-beta, -alpha,  board, info);
+		Take_Move(board);
+		moves_searched++;
+
+		if (SEARCH_ABORTED(info))
 		{
 			return 0;
 		}
 		if (score >= beta)
 		{
+			if (info->use_hash)
+			{
+				Fill_Hash_Entry(info->age, HASH_QS_DEPTH, score, HASH_LOWER, board->hash_key, next_move, &hash_entry);
+				Store_Hash_Entry(&hash_entry, board->hply, info);
+			}
 			return score; //Beta cutoff
 		}
-		if (score > best_score) best_score = score;
+		if (score > best_score)
+		{
+			best_score = score;
+			best_move = next_move;
+		}
 		if (score > alpha)
 		{
 			alpha = score;
 		}
 	}
+
+	//Store exact score if alpha was raised, otherwise an upper bound
+	if (moves_searched && info->use_hash)
+	{
+		Fill_Hash_Entry(info->age, HASH_QS_DEPTH, best_score, (best_score > alpha_orig) ? HASH_EXACT : HASH_UPPER, board->hash_key, best_move, &hash_entry);
+		Store_Hash_Entry(&hash_entry, board->hply, info);
+	}
+
 	return best_score;
 }
 
@@ -648,7 +850,7 @@ void Internal_Iterative_Deepening(int alpha, int beta, int depth, MOVE_LIST_STRU
 		//Make move
 		if (Make_Move(move_list->list[i].move, board))
 		{
-			move_list->list[i].score = -Alpha_Beta(-beta, -alpha, iid_depth, PV, DO_NULL, board, info);
+			move_list->list[i].score = -Alpha_Beta<PV>(-beta, -alpha, iid_depth, DO_NULL, board, info);
 
 			Take_Move(board);
 		}
@@ -10,11 +10,24 @@ void Clear_Search_Info(SEARCH_INFO_STRUCT *info)
 {
 	//Reset stop flag
 	info->stopped = 0;
+	info->ponderhit = 0;
+	info->pondering = 0;
 	info->nodes = 0;
+	info->total_nodes = 0;
+	info->node_limit = 0;
+	info->pv_index = 0;
+	info->thread_index = 0;
+	info->split_point = NULL;
 
+	info->use_hash = 1;
 	info->hash_hits = 0;
 	info->hash_probes = 0;
 
+	info->qs_nodes = 0;
+	info->tb_hits = 0;
+	info->delta_pruned = 0;
+	info->see_pruned = 0;
+
 	memset(info->best_index, 0, MAX_MOVE_LIST_LENGTH*sizeof(int));
 	memset(info->beta_cutoff_index, 0, MAX_MOVE_LIST_LENGTH*sizeof(int));
 }
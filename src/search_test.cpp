@@ -101,6 +101,7 @@ void Search_Test(void)
 		Clear_Search_Info(&info);
 		Clear_History_Data(&board);
 		board.hply = 0;
+		Init_Root_Moves(&info.root_moves, &board);
 
 		info.start_time = Get_Time_Ms();
 		info.stop_time = info.start_time + TEST_TIME;
@@ -116,7 +117,7 @@ void Search_Test(void)
 		{
 			info.nodes = 0;
 
-			Alpha_Beta(-INF, INF, depth, PV, DO_NULL, &board, &info);
+			Alpha_Beta<ROOT>(-INF, INF, depth, DO_NULL, &board, &info);
 
 			if (info.stopped)//Print results if finished
 			{
@@ -148,4 +149,235 @@ void Search_Test(void)
 	//Summary of all positions
 	printf("\nSummary Averages:\nDepth:%f NPS:%d Branching:%f HR:%d\n", total_depth / NUM_POSITIONS, total_nps / NUM_POSITIONS, total_branching_factor / NUM_POSITIONS, total_hit_rate / NUM_POSITIONS);
 	printf("Average Indices: Best Move:%f Beta Cutoff:%f\n\n", best_index_total / NUM_POSITIONS, beta_index_total / NUM_POSITIONS);
-}
\ No newline at end of file
+}
+
+//Searches every position to a fixed depth and prints node counts, used to compare search options
+void Node_Count_Test(int depth)
+{
+	BOARD_STRUCT board;
+	SEARCH_INFO_STRUCT info;
+	int test_start_time = Get_Time_Ms();
+	long pos_nodes;
+	long total_nodes = 0;
+	long total_qs_nodes = 0;
+	long total_delta_pruned = 0;
+	long total_see_pruned = 0;
+
+	memset(&board, 0, sizeof(board)); //Start with empty killer and history tables
+
+	printf("\n\nNode Count Test Started\n%d positions\nDepth %d\nThreads %d SMPMode %d\n", NUM_POSITIONS, depth, num_threads, smp_mode);
+
+	//Loop through all positions
+	for (int pos = 0; pos < NUM_POSITIONS; pos++)
+	{
+		//Parse position
+		Parse_Fen(fens[pos], &board);
+
+		//Prepare for iterative deepening loop
+		Clear_Pawn_Hash_Table();
+		Clear_Hash_Table();
+		Clear_Search_Info(&info);
+		Clear_History_Data(&board);
+		memset(board.the_killers, 0, sizeof(board.the_killers));
+		board.hply = 0;
+		Init_Root_Moves(&info.root_moves, &board);
+		info.time_set = 0;
+		info.start_time = Get_Time_Ms();
+		info.quit = 0;
+		info.depth = depth;
+
+		pos_nodes = 0;
+		Start_Helpers(&board, &info);
+
+		//Iterative deepening to the fixed depth
+		for (int current_depth = 1; current_depth <= depth; current_depth++)
+		{
+			info.nodes = 0;
+			Alpha_Beta<ROOT>(-INF, INF, current_depth, DO_NULL, &board, &info);
+			pos_nodes += info.nodes;
+		}
+
+		Stop_Helpers();
+
+		//Time to depth is the measure for comparing thread counts and smp modes
+		printf("Position %d: Nodes:%ld QNodes:%ld Delta Pruned:%ld SEE Pruned:%ld Time:%d\n", pos, pos_nodes, info.qs_nodes, info.delta_pruned, info.see_pruned, Get_Time_Ms() - info.start_time);
+		total_nodes += pos_nodes;
+		total_qs_nodes += info.qs_nodes;
+		total_delta_pruned += info.delta_pruned;
+		total_see_pruned += info.see_pruned;
+	}
+
+	//Summary of all positions
+	printf("\nTotal Nodes:%ld Time:%d\n", total_nodes, Get_Time_Ms() - test_start_time);
+	printf("QNodes:%ld Delta Pruned:%ld SEE Pruned:%ld\n\n", total_qs_nodes, total_delta_pruned, total_see_pruned);
+}
+
+//Times the set-wise pawn evaluation against the per pawn reference over the test positions, and checks that they agree
+void Pawn_Eval_Test(int passes)
+{
+	BOARD_STRUCT board;
+	int start_time;
+	int setwise_time = 0;
+	int per_pawn_time = 0;
+	int mismatches = 0;
+	volatile int sink = 0; //Keeps the timed calls from being optimized away
+
+	printf("\n\nPawn Eval Test Started\n%d positions\n%d passes\n", NUM_POSITIONS, passes);
+
+	for (int pos = 0; pos < NUM_POSITIONS; pos++)
+	{
+		Parse_Fen(fens[pos], &board);
+
+		int setwise_score = Get_Pawn_Eval_Score(&board);
+		int per_pawn_score = Get_Pawn_Eval_Score_Per_Pawn(&board);
+		if (setwise_score != per_pawn_score)
+		{
+			printf("Position %d: Set-wise:%d Per pawn:%d\n", pos, setwise_score, per_pawn_score);
+			mismatches++;
+		}
+
+		start_time = Get_Time_Ms();
+		for (int i = 0; i < passes; i++) sink += Get_Pawn_Eval_Score(&board);
+		setwise_time += Get_Time_Ms() - start_time;
+
+		start_time = Get_Time_Ms();
+		for (int i = 0; i < passes; i++) sink += Get_Pawn_Eval_Score_Per_Pawn(&board);
+		per_pawn_time += Get_Time_Ms() - start_time;
+	}
+
+	printf("\nSet-wise Time:%d Per Pawn Time:%d Mismatches:%d\n\n", setwise_time, per_pawn_time, mismatches);
+}
+
+
+/***** Tablebase Test *****/
+/* Checks the syzygy prober against real tables, positions whose tables are missing are skipped */
+
+#define NUM_TB_POSITIONS		14
+#define TB_SIGN_ONLY			INVALID //Only the sign of the dtz is checked
+
+typedef struct
+{
+	char *fen;
+	int wdl;
+	int dtz;
+}TB_TEST_POSITION_STRUCT;
+
+TB_TEST_POSITION_STRUCT tb_positions[NUM_TB_POSITIONS] = {
+	{ "k7/8/1K6/8/8/8/8/6Q1 w - - 0 1", 2, 1 }, //KQvK, Qg8 mates
+	{ "k7/8/1K6/8/8/8/8/6Q1 b - - 0 1", -2, TB_SIGN_ONLY },
+	{ "8/8/8/4k3/8/8/8/KR6 w - - 0 1", 2, TB_SIGN_ONLY }, //KRvK
+	{ "8/8/8/4k3/8/8/8/KR6 b - - 0 1", -2, TB_SIGN_ONLY },
+	{ "8/8/8/4k3/8/8/8/KB6 w - - 0 1", 0, 0 }, //KBvK
+	{ "8/8/8/4k3/8/8/r7/KQ6 w - - 0 1", 2, 1 }, //KQvKR, the rook is taken
+	{ "7k/8/8/8/8/8/7P/7K w - - 0 1", 0, 0 }, //KPvK, rook pawn with the king in the corner
+	{ "8/8/8/8/8/8/4P3/4K2k w - - 0 1", 2, 1 }, //KPvK, the pawn outruns the king
+	{ "8/8/8/4k3/8/8/8/KBN5 w - - 0 1", 2, TB_SIGN_ONLY }, //KBNvK
+	{ "8/8/8/4k3/8/8/8/KNN5 w - - 0 1", 0, 0 }, //KNNvK
+	{ "8/8/8/4k3/8/8/8/KB1B4 w - - 0 1", 0, 0 }, //KBBvK, bishops on the same color
+	{ "8/8/8/4k3/8/8/8/KB1B1B2 w - - 0 1", 0, 0 }, //KBBBvK, bishops on the same color
+	{ "8/8/8/4k3/8/8/8/KQRB4 w - - 0 1", 2, TB_SIGN_ONLY }, //KQRBvK
+	{ "8/8/8/4k3/8/8/8/KQRB4 b - - 0 1", -2, TB_SIGN_ONLY }
+};
+
+//Returns 1 if the probe results match the expected wdl and dtz, prints the position if not
+static int Check_TB_Position(char *fen, int wdl, int dtz, BOARD_STRUCT *board)
+{
+	int found_wdl, found_dtz;
+
+	Parse_Fen(fen, board);
+	int probe_wdl = TB_Probe_WDL(board, &found_wdl);
+	int probe_dtz = TB_Probe_DTZ(board, &found_dtz);
+	if (!found_wdl || !found_dtz) return -1;
+
+	if (probe_wdl == wdl && ((dtz == TB_SIGN_ONLY) ? (probe_dtz > 0) - (probe_dtz < 0) == (wdl > 0) - (wdl < 0) : probe_dtz == dtz)) return 1;
+
+	printf("%s expected wdl %d dtz %d, found wdl %d dtz %d\n", fen, wdl, dtz, probe_wdl, probe_dtz);
+	return 0;
+}
+
+//Probes known positions with the tables in path, then every KPvK position against the KPK bitbase
+void TB_Test(char *path)
+{
+	BOARD_STRUCT board;
+	char fen[100];
+	int passed = 0, failed = 0, skipped = 0;
+	int result;
+
+	TB_Init(path);
+	printf("\n\nTablebase Test Started\nLargest table: %d pieces\n", tb_largest);
+
+	for (int pos = 0; pos < NUM_TB_POSITIONS; pos++)
+	{
+		result = Check_TB_Position(tb_positions[pos].fen, tb_positions[pos].wdl, tb_positions[pos].dtz, &board);
+		if (result == 1) passed++;
+		else if (result == 0) failed++;
+		else skipped++;
+	}
+	printf("Known positions: %d passed, %d failed, %d skipped\n", passed, failed, skipped);
+
+	//The bitbase is generated separately, so every legal KPvK position is an independent check of the wdl table
+	int found;
+	Parse_Fen("8/8/8/8/8/8/4P3/4K2k w - - 0 1", &board);
+	TB_Probe_WDL(&board, &found);
+	if (!found)
+	{
+		printf("KPvK table not found\n\n");
+		return;
+	}
+
+	passed = failed = 0;
+	for (int side = WHITE; side <= BLACK; side++)
+	{
+		for (int pawn = 8; pawn < 56; pawn++)
+		{
+			for (int white_king = 0; white_king < 64; white_king++)
+			{
+				for (int black_king = 0; black_king < 64; black_king++)
+				{
+					if (white_king == pawn || black_king == pawn || white_king == black_king) continue;
+					if (abs(GET_RANK(white_king) - GET_RANK(black_king)) <= 1 && abs(GET_FILE(white_king) - GET_FILE(black_king)) <= 1) continue;
+
+					//Fen with ranks from 8 to 1
+					char squares[64];
+					int length = 0;
+					memset(squares, 0, sizeof(squares));
+					squares[white_king] = 'K';
+					squares[black_king] = 'k';
+					squares[pawn] = 'P';
+					for (int rank = RANK_8; rank >= RANK_1; rank--)
+					{
+						int empty = 0;
+						for (int file = FILE_A; file <= FILE_H; file++)
+						{
+							char piece = squares[rank * 8 + file];
+							if (piece == 0)
+							{
+								empty++;
+								continue;
+							}
+							if (empty) fen[length++] = '0' + empty;
+							empty = 0;
+							fen[length++] = piece;
+						}
+						if (empty) fen[length++] = '0' + empty;
+						if (rank != RANK_1) fen[length++] = '/';
+					}
+					memcpy(fen + length, (side == WHITE) ? " w - - 0 1" : " b - - 0 1", 11);
+
+					Parse_Fen(fen, &board);
+					if (In_Check(side ^ 1, &board)) continue; //Side that just moved cannot be in check
+
+					int wdl = TB_Probe_WDL(&board, &found);
+					int expected = KPK_Probe(&board) ? ((side == WHITE) ? 2 : -2) : 0;
+					if (found && wdl == expected) passed++;
+					else
+					{
+						if (failed < 10) printf("%s expected wdl %d, found %d\n", fen, expected, wdl);
+						failed++;
+					}
+				}
+			}
+		}
+	}
+	printf("KPvK positions: %d passed, %d failed\n\n", passed, failed);
+}
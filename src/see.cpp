@@ -48,12 +48,7 @@ int Static_Exchange_Evaluation(int move, BOARD_STRUCT *board)
 	//Remove attacking piece
 	all_pieces &= ~(1i64 << GET_FROM_SQ(move));
 
-	U64 all_attackers = ((bpawn_attack_masks[square] & board->piece_bitboards[wP]) |
-		(wpawn_attack_masks[square] & board->piece_bitboards[bP]) |
-		(knight_attack_masks[square] & (board->piece_bitboards[wN] | board->piece_bitboards[bN])) |
-		(Bishop_Attacks(all_pieces, square) & all_bishops) |
-		(Rook_Attacks(all_pieces, square) & all_rooks) |
-		(king_attack_masks[square] & (board->piece_bitboards[wK] | board->piece_bitboards[bK])));
+	U64 all_attackers = Attackers_To(square, all_pieces, board);
 
 	//Remove attacking piece
 	all_attackers &= ~(1i64 << GET_FROM_SQ(move));
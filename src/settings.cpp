@@ -7,7 +7,10 @@
 
 /***** Settings *****/
 int use_SEE = 0;
-int quiescent_SEE = 0; //Use SEE for pruning in quiescence search
+int quiescent_SEE = 0; //Use SEE for ordering in quiescence search
+int use_delta_pruning = 1;
+int delta_margin = 200; //Added to captured piece value before comparing to alpha
+int use_see_pruning = 1; //Skip losing captures in quiescence search
 int use_aspiration_window = 0;
 int use_history = 0;
 int only_research_in_pv = 0;
@@ -18,6 +21,7 @@ int use_extra_lmr = 1;
 double lmr_depth_mod = .649;
 double lmr_move_mod = .144;
 double lmr_pv_mod = .246;
+char lmr_reductions[MAX_SEARCH_DEPTH][MAX_MOVE_LIST_LENGTH][2]; //[depth][move][pv], filled by Init_LMR_Table
 
 /* Null Move*/
 int adapt_null_move = 0; //Use adaptive reduction based on depth
@@ -25,6 +29,33 @@ double null_move_depth_mod = .42; //Reduction based on depth
 int null_move_mat = 700; //Big material required to do a null move
 const int null_move_material_data[7] = { 0, 300, 500, 600, 700, 900, 1000 };
 
+/* Internal Iterative Deepening */
+int iid_mode = IID_SWEEP; //Sweep all moves, search node at half depth, or reduce depth
+
+/* Time */
+int move_overhead = 30; //Time kept back per move for gui and communication lag
+
+/* Analysis */
+int multi_pv = 1; //Number of root lines searched and reported
+
+/* Parallel Search */
+int num_threads = 1; //Search threads including the main thread
+int smp_mode = SMP_SHARED_HASH; //How helper threads share the search
+int use_numa = 0; //Bind threads to numa nodes, allocate thread data on their node and interleave the hash table
+
+/* Evaluation */
+int use_nnue = 0; //Use the network instead of the classical eval, requires a loaded weights file
+int use_attack_eval = 0; //Mobility, threat and king attack terms from the attack maps, off until the weights are tuned
+int use_attack_ordering = 1; //Order quiet moves onto squares attacked by enemy pawns last
+int use_lazy_eval = 1; //Skip pawn, king and attack terms when the fast terms are far outside the window
+int lazy_eval_margin = 500; //Largest change the skipped terms can make, king attack units alone reach 390
+
+/* Tablebases */
+int use_tb_probe = 0; //Probe syzygy tables at the root and in search, off until tb_test passes with the tables used
+
+/* Benchmarking */
+int deterministic = 0; //Fixed hashkeys and no time limits so searches can be repeated exactly
+
 /* Variable Tuning */
 int test[6] = { 0 }; //Can be temporarily used for anything
 
@@ -32,8 +63,30 @@ int test[6] = { 0 }; //Can be temporarily used for anything
 int use_futility = 1;
 int use_late_move_reduction = 1;
 
+//Fills the late move reduction table from the current lmr settings
+void Init_LMR_Table(void)
+{
+	for (int depth = 0; depth < MAX_SEARCH_DEPTH; depth++)
+	{
+		for (int move = 0; move < MAX_MOVE_LIST_LENGTH; move++)
+		{
+			if (use_extra_lmr)
+			{
+				double reduction = sqrt(depth * lmr_depth_mod) + sqrt(move * lmr_move_mod);
+				lmr_reductions[depth][move][NOT_PV] = (char)reduction; //Floor
+				lmr_reductions[depth][move][PV] = (char)(reduction * lmr_pv_mod);
+			}
+			else
+			{
+				lmr_reductions[depth][move][NOT_PV] = 1;
+				lmr_reductions[depth][move][PV] = 1;
+			}
+		}
+	}
+}
+
 //Takes a string and parses settings from it
-void Set_Option(char * line)
+void Set_Option(char * line, BOARD_STRUCT *board)
 {
 	//Test array
 	if (!strncmp(line, "setoption name test", 18)) {
@@ -53,6 +106,7 @@ void Set_Option(char * line)
 		printf("Set keps%d to %d\n", index, value);
 		king_end_piece_square_tuning_values[index] = value;
 		Set_King_End_Values();
+		Init_Piece_Square_Tables();
 	}
 	//Pawn endgame piece square
 	else if (!strncmp(line, "setoption name peps", 18)) {
@@ -63,6 +117,7 @@ void Set_Option(char * line)
 		printf("Set peps%d to %d\n", index, value);
 		pawn_end_piece_square_tuning_values[index] = value;
 		Set_Pawn_End_Values();
+		Init_Piece_Square_Tables();
 	}
 	//Passed pawn rank bonus
 	else if (!strncmp(line, "setoption name pprb", 18)) {
@@ -94,6 +149,27 @@ void Set_Option(char * line)
 		printf("Set quiescent_SEE to %d\n", value);
 		quiescent_SEE = value;
 	}
+	//Delta pruning in quiescent search
+	else if (!strncmp(line, "setoption name delta_pruning", 27)) {
+		int value = 0;
+		sscanf_s(line, "%*s %*s %*s %*s %d", &value);
+		printf("Set delta_pruning to %d\n", value);
+		use_delta_pruning = value;
+	}
+	//Delta pruning margin
+	else if (!strncmp(line, "setoption name delta_margin", 26)) {
+		int value = 0;
+		sscanf_s(line, "%*s %*s %*s %*s %d", &value);
+		printf("Set delta_margin to %d\n", value);
+		delta_margin = value;
+	}
+	//SEE pruning in quiescent search
+	else if (!strncmp(line, "setoption name see_pruning", 25)) {
+		int value = 0;
+		sscanf_s(line, "%*s %*s %*s %*s %d", &value);
+		printf("Set see_pruning to %d\n", value);
+		use_see_pruning = value;
+	}
 	//Aspiration window size
 	else if (!strncmp(line, "setoption name aspiration", 24)) {
 		int value = 0;
@@ -123,6 +199,7 @@ void Set_Option(char * line)
 		sscanf_s(line, "%*s %*s %*s %*s %d", &value);
 		printf("Set extra_lmr to %d\n", value);
 		use_extra_lmr = value;
+		Init_LMR_Table();
 	}
 	//LMR depth modifier
 	else if (!strncmp(line, "setoption name lmr_depth_mod", 27)) {
@@ -130,6 +207,7 @@ void Set_Option(char * line)
 		sscanf_s(line, "%*s %*s %*s %*s %f", &value);
 		printf("Set lmr_depth_mod to %f\n", value);
 		lmr_depth_mod = value;
+		Init_LMR_Table();
 	}
 	//LMR move modifier
 	else if (!strncmp(line, "setoption name lmr_move_mod", 26)) {
@@ -137,6 +215,7 @@ void Set_Option(char * line)
 		sscanf_s(line, "%*s %*s %*s %*s %f", &value);
 		printf("Set lmr_move_mod to %f\n", value);
 		lmr_move_mod = value;
+		Init_LMR_Table();
 	}
 	//LMR PV modifier
 	else if (!strncmp(line, "setoption name lmr_pv_mod", 24)) {
@@ -144,6 +223,7 @@ void Set_Option(char * line)
 		sscanf_s(line, "%*s %*s %*s %*s %f", &value);
 		printf("Set lmr_pv_mod to %f\n", value);
 		lmr_pv_mod = value;
+		Init_LMR_Table();
 	}
 	//Null move depth reduction based on search depth
 	else if (!strncmp(line, "setoption name adapt_null_move", 29)) {
@@ -173,4 +253,129 @@ void Set_Option(char * line)
 		printf("Set only_research_in_pv to %d\n", value);
 		only_research_in_pv = value;
 	}
+	//Internal iterative deepening mode
+	else if (!strncmp(line, "setoption name iid_mode", 22)) {
+		int value = 0;
+		sscanf_s(line, "%*s %*s %*s %*s %d", &value);
+		if (value < IID_SWEEP) value = IID_SWEEP;
+		if (value > IID_REDUCTION) value = IID_REDUCTION;
+		printf("Set iid_mode to %d\n", value);
+		iid_mode = value;
+	}
+	//Move overhead in ms
+	else if (!strncmp(line, "setoption name move_overhead", 27)) {
+		int value = 0;
+		sscanf_s(line, "%*s %*s %*s %*s %d", &value);
+		printf("Set move_overhead to %d\n", value);
+		move_overhead = value;
+	}
+	//Number of lines to report
+	else if (!strncmp(line, "setoption name MultiPV", 21)) {
+		int value = 0;
+		sscanf_s(line, "%*s %*s %*s %*s %d", &value);
+		printf("Set MultiPV to %d\n", value);
+		if (value < 1) value = 1;
+		if (value > MAX_MOVE_LIST_LENGTH) value = MAX_MOVE_LIST_LENGTH;
+		multi_pv = value;
+	}
+	//Number of search threads
+	else if (!strncmp(line, "setoption name Threads", 21)) {
+		int value = 0;
+		sscanf_s(line, "%*s %*s %*s %*s %d", &value);
+		if (value < 1) value = 1;
+		if (value > MAX_THREADS) value = MAX_THREADS;
+		printf("Set Threads to %d\n", value);
+		num_threads = value;
+		Init_Threads(value);
+	}
+	//Shared hash or split point parallel search
+	else if (!strncmp(line, "setoption name SMPMode", 21)) {
+		int value = 0;
+		sscanf_s(line, "%*s %*s %*s %*s %d", &value);
+		printf("Set SMPMode to %d\n", value);
+		smp_mode = value;
+	}
+	//Numa placement, the hash table and threads are allocated again
+	else if (!strncmp(line, "setoption name NUMA", 18)) {
+		int value = 0;
+		sscanf_s(line, "%*s %*s %*s %*s %d", &value);
+		printf("Set NUMA to %d\n", value);
+		use_numa = value;
+		Alloc_Hash_Table();
+		Init_Threads(num_threads);
+	}
+	//Network weights file
+	else if (!strncmp(line, "setoption name EvalFile", 22)) {
+		char *path = strstr(line, "value ");
+		if (path == NULL) return;
+		path += 6;
+		path[strcspn(path, "\r\n")] = '\0';
+		if (NN_Load(path)) printf("Loaded network %s\n", path);
+		else printf("Could not load network %s\n", path);
+		if (!nn_loaded) use_nnue = 0;
+	}
+	//Syzygy tablebase directories, separated by ';'
+	else if (!strncmp(line, "setoption name SyzygyPath", 24)) {
+		char *path = strstr(line, "value ");
+		if (path == NULL) return;
+		path += 6;
+		path[strcspn(path, "\r\n")] = '\0';
+		TB_Init(path);
+	}
+	else if (!strncmp(line, "setoption name SyzygyProbe", 25)) {
+		int value = 0;
+		sscanf_s(line, "%*s %*s %*s %*s %d", &value);
+		if (strstr(line, "value true")) value = 1;
+		printf("Set SyzygyProbe to %d\n", value);
+		use_tb_probe = value;
+	}
+	//Network or classical eval, accumulators are refreshed when the next search starts
+	else if (!strncmp(line, "setoption name UseNNUE", 21)) {
+		int value = 0;
+		sscanf_s(line, "%*s %*s %*s %*s %d", &value);
+		if (strstr(line, "value true")) value = 1;
+		if (value && !nn_loaded) {
+			printf("No network loaded, using classical eval\n");
+			value = 0;
+		}
+		printf("Set UseNNUE to %d\n", value);
+		use_nnue = value;
+	}
+	//Attack maps
+	else if (!strncmp(line, "setoption name attack_eval", 25)) {
+		int value = 0;
+		sscanf_s(line, "%*s %*s %*s %*s %d", &value);
+		printf("Set attack_eval to %d\n", value);
+		use_attack_eval = value;
+	}
+	else if (!strncmp(line, "setoption name attack_ordering", 29)) {
+		int value = 0;
+		sscanf_s(line, "%*s %*s %*s %*s %d", &value);
+		printf("Set attack_ordering to %d\n", value);
+		use_attack_ordering = value;
+	}
+	//Lazy evaluation
+	else if (!strncmp(line, "setoption name lazy_eval_margin", 30)) {
+		int value = 0;
+		sscanf_s(line, "%*s %*s %*s %*s %d", &value);
+		printf("Set lazy_eval_margin to %d\n", value);
+		lazy_eval_margin = value;
+	}
+	else if (!strncmp(line, "setoption name lazy_eval", 23)) {
+		int value = 0;
+		sscanf_s(line, "%*s %*s %*s %*s %d", &value);
+		printf("Set lazy_eval to %d\n", value);
+		use_lazy_eval = value;
+	}
+	//Deterministic mode, hashkeys change so the board keys are recomputed and tables are cleared
+	else if (!strncmp(line, "setoption name deterministic", 27)) {
+		int value = 0;
+		sscanf_s(line, "%*s %*s %*s %*s %d", &value);
+		printf("Set deterministic to %d\n", value);
+		deterministic = value;
+		Reset_Hashkeys(board);
+		Clear_Hash_Table();
+		Clear_Pawn_Hash_Table();
+		Clear_History_Data(board);
+	}
 }
\ No newline at end of file
@@ -0,0 +1,307 @@
+/* smp.cpp
+* Contains the helper thread pool and split points for parallel search
+* Theo Kanning
+*/
+
+#include "globals.h"
+#include <thread>
+#include <condition_variable>
+#include <new>
+
+typedef struct
+{
+	BOARD_STRUCT board; //Own copy of the position being searched
+	BOARD_STRUCT help_boards[MAX_SPLIT_POINTS]; //Used by the owner of each split point to help its helpers while it waits
+	SEARCH_INFO_STRUCT info;
+	SPLIT_POINT_STRUCT split_points[MAX_SPLIT_POINTS]; //Split points owned by this thread, used as a stack
+	int num_split_points;
+	std::atomic<int> searching; //Shared hash mode, set while the helper runs its own search
+	std::atomic<int> exit;
+	int node; //Numa node the thread and its data are placed on, -1 if numa is off
+	std::thread thread;
+}THREAD_STRUCT;
+
+/***** Thread Pool *****/
+/* Slot 0 only holds the main thread's split points, helpers run in slots 1 and up */
+static THREAD_STRUCT *threads[MAX_THREADS];
+static int thread_count = 1;
+
+/* Open split points are published here, idle helpers pick one to join */
+static std::mutex smp_lock;
+static std::condition_variable smp_signal;
+static SPLIT_POINT_STRUCT *open_split_points[MAX_THREADS * MAX_SPLIT_POINTS];
+static int num_open_split_points = 0;
+static std::atomic<int> idle_helpers(0);
+
+//Returns 1 if sp was opened by a thread searching under ancestor
+static int Is_Below(SPLIT_POINT_STRUCT *sp, SPLIT_POINT_STRUCT *ancestor)
+{
+	for (sp = sp->parent; sp != NULL; sp = sp->parent)
+	{
+		if (sp == ancestor) return 1;
+	}
+	return 0;
+}
+
+//Finds the open split point with the most depth left that still has moves, and joins it
+//If below is not NULL only split points under it are joined, called with smp_lock held, returns NULL if there is no work
+static SPLIT_POINT_STRUCT *Join_Split_Point(SPLIT_POINT_STRUCT *below)
+{
+	SPLIT_POINT_STRUCT *best = NULL;
+
+	for (int i = 0; i < num_open_split_points; i++)
+	{
+		SPLIT_POINT_STRUCT *sp = open_split_points[i];
+		if (below != NULL && !Is_Below(sp, below)) continue;
+		if (!sp->cutoff && sp->next_move < sp->move_list.num && (best == NULL || sp->depth > best->depth)) best = sp;
+	}
+
+	//Counted before smp_lock is released so the owner cannot finish and reuse the split point first
+	if (best) best->workers++;
+
+	return best;
+}
+
+//Searches moves from a joined split point on board, a free board of the calling thread
+//Nodes and tablebase hits are moved to the split point, its owner adds them to its own count
+static void Help_Split_Point(SPLIT_POINT_STRUCT *sp, BOARD_STRUCT *board, SEARCH_INFO_STRUCT *info)
+{
+	long start_nodes = info->nodes;
+	long start_tb_hits = info->tb_hits;
+
+	Copy_Position(board, &sp->board);
+
+	Search_Split_Point(sp, board, info);
+
+	sp->nodes += info->nodes - start_nodes;
+	sp->tb_hits += info->tb_hits - start_tb_hits;
+	info->nodes = start_nodes;
+	info->tb_hits = start_tb_hits;
+	sp->workers--;
+}
+
+//Iterative deepening without a time limit until the main thread stops it, results only reach the main thread through the hash table
+static void Shared_Hash_Search(THREAD_STRUCT *thread)
+{
+	//Odd helpers start a ply deeper so threads are not all searching the same depth
+	for (int depth = 1 + (thread->info.thread_index & 1); depth <= thread->info.depth && !thread->info.stopped; depth++)
+	{
+		thread->info.nodes = 0;
+		Alpha_Beta<ROOT>(-INF, INF, depth, DO_NULL, &thread->board, &thread->info);
+	}
+
+	thread->searching = 0;
+}
+
+//Creates a thread's data on its numa node, the board inside holds the killer and history tables
+static THREAD_STRUCT *New_Thread(int index)
+{
+	int node = use_numa ? index % Numa_Node_Count() : -1;
+	THREAD_STRUCT *thread = new (Numa_Alloc(sizeof(THREAD_STRUCT), node)) THREAD_STRUCT;
+
+	thread->node = node;
+	thread->num_split_points = 0;
+	thread->searching = 0;
+	thread->exit = 0;
+	return thread;
+}
+
+static void Delete_Thread(THREAD_STRUCT *thread)
+{
+	thread->~THREAD_STRUCT();
+	Numa_Free(thread);
+}
+
+//Main loop for helper threads, waits for work until the pool is resized
+static void Helper_Loop(THREAD_STRUCT *thread)
+{
+	if (thread->node >= 0) Bind_Thread_To_Node(thread->node);
+
+	std::unique_lock<std::mutex> lock(smp_lock);
+
+	while (!thread->exit)
+	{
+		if (thread->searching)
+		{
+			lock.unlock();
+			Shared_Hash_Search(thread);
+			lock.lock();
+			continue;
+		}
+
+		SPLIT_POINT_STRUCT *sp = Join_Split_Point(NULL);
+		if (sp)
+		{
+			lock.unlock();
+			thread->info.age = sp->age;
+			thread->info.stopped = 0;
+			Help_Split_Point(sp, &thread->board, &thread->info);
+			lock.lock();
+			continue;
+		}
+
+		idle_helpers++;
+		smp_signal.wait(lock);
+		idle_helpers--;
+	}
+}
+
+//Sets the number of search threads, helpers are stopped and restarted
+void Init_Threads(int num)
+{
+	if (num < 1) num = 1;
+	if (num > MAX_THREADS) num = MAX_THREADS;
+
+	//Stop current helpers
+	{
+		std::lock_guard<std::mutex> lock(smp_lock);
+		for (int i = 1; i < thread_count; i++) threads[i]->exit = 1;
+	}
+	smp_signal.notify_all();
+	for (int i = 1; i < thread_count; i++)
+	{
+		threads[i]->thread.join();
+		Delete_Thread(threads[i]);
+	}
+
+	//Numa may have changed, so the main thread's split points are placed again
+	if (threads[0] != NULL) Delete_Thread(threads[0]);
+	threads[0] = New_Thread(0);
+
+	for (int i = 1; i < num; i++)
+	{
+		threads[i] = New_Thread(i);
+		Clear_Search_Info(&threads[i]->info);
+		threads[i]->info.thread_index = i;
+		threads[i]->info.quit = 0;
+		threads[i]->thread = std::thread(Helper_Loop, threads[i]);
+	}
+
+	thread_count = num;
+}
+
+//Starts helpers at the beginning of a search, in shared hash mode each one searches its own copy of the root
+void Start_Helpers(BOARD_STRUCT *board, SEARCH_INFO_STRUCT *info)
+{
+	if (threads[0] != NULL && threads[0]->node >= 0) Bind_Thread_To_Node(threads[0]->node); //Searches run on a new thread each time
+
+	if (smp_mode != SMP_SHARED_HASH) return; //Split point helpers start when a split point is opened
+
+	{
+		std::lock_guard<std::mutex> lock(smp_lock);
+		for (int i = 1; i < thread_count; i++)
+		{
+			THREAD_STRUCT *thread = threads[i];
+
+			Copy_Position(&thread->board, board);
+			Clear_History_Data(&thread->board);
+			Clear_Search_Info(&thread->info);
+			thread->info.thread_index = i;
+			thread->info.time_set = 0;
+			thread->info.depth = info->depth;
+			thread->info.age = info->age;
+			Init_Root_Moves(&thread->info.root_moves, &thread->board);
+			thread->searching = 1;
+		}
+	}
+	smp_signal.notify_all();
+}
+
+//Stops shared hash helpers and waits until they are idle
+void Stop_Helpers(void)
+{
+	for (int i = 1; i < thread_count; i++) threads[i]->info.stopped = 1;
+	for (int i = 1; i < thread_count; i++)
+	{
+		while (threads[i]->searching) std::this_thread::yield();
+	}
+}
+
+//Returns 1 if the thread searching with info can open a split point
+int Can_Split(SEARCH_INFO_STRUCT *info)
+{
+	return smp_mode == SMP_YBW
+		&& idle_helpers > 0
+		&& threads[info->thread_index]->num_split_points < MAX_SPLIT_POINTS;
+}
+
+//Searches the rest of a node's moves together with any idle helpers, starting at first_move
+//Returns the best score among those moves, best_move and best_move_score are set to the move that scored it
+int Split(int alpha, int beta, int depth, int in_check, int first_move, int moves_made, MOVE_LIST_STRUCT *move_list, int *best_move, int *best_move_score, BOARD_STRUCT *board, SEARCH_INFO_STRUCT *info)
+{
+	THREAD_STRUCT *thread = threads[info->thread_index];
+	SPLIT_POINT_STRUCT *sp = &thread->split_points[thread->num_split_points++];
+
+	Copy_Position(&sp->board, board);
+	sp->move_list = *move_list;
+	sp->next_move = first_move;
+	sp->moves_made = moves_made;
+	sp->alpha = alpha;
+	sp->beta = beta;
+	sp->depth = depth;
+	sp->in_check = in_check;
+	sp->age = info->age;
+	sp->best_score = -INF;
+	sp->best_move = 0;
+	sp->best_move_score = 0;
+	sp->cutoff = 0;
+	sp->workers = 0;
+	sp->nodes = 0;
+	sp->tb_hits = 0;
+	sp->parent = info->split_point;
+
+	//Open for helpers
+	{
+		std::lock_guard<std::mutex> lock(smp_lock);
+		open_split_points[num_open_split_points++] = sp;
+	}
+	smp_signal.notify_all();
+
+	Search_Split_Point(sp, board, info);
+
+	//Close it, then wait for helpers that are still searching
+	{
+		std::lock_guard<std::mutex> lock(smp_lock);
+		for (int i = 0; i < num_open_split_points; i++)
+		{
+			if (open_split_points[i] == sp)
+			{
+				open_split_points[i] = open_split_points[--num_open_split_points];
+				break;
+			}
+		}
+	}
+	//Help the threads still searching here instead of waiting, only split points they opened below this one are joined
+	//so the owner is back in time when its last helper finishes
+	BOARD_STRUCT *help_board = &thread->help_boards[thread->num_split_points - 1];
+	while (sp->workers > 0)
+	{
+		if (info->stopped) sp->cutoff = 1; //Helpers do not see the main thread's stop flag
+
+		SPLIT_POINT_STRUCT *below;
+		{
+			std::lock_guard<std::mutex> lock(smp_lock);
+			below = Join_Split_Point(sp);
+		}
+		if (below) Help_Split_Point(below, help_board, info);
+		else std::this_thread::yield();
+	}
+
+	info->nodes += sp->nodes;
+	info->tb_hits += sp->tb_hits;
+	thread->num_split_points--;
+
+	*best_move = sp->best_move;
+	*best_move_score = sp->best_move_score;
+	return sp->best_score;
+}
+
+//Returns 1 if a split point or any split point above it has been cut off
+int Split_Aborted(SPLIT_POINT_STRUCT *sp)
+{
+	for (; sp != NULL; sp = sp->parent)
+	{
+		if (sp->cutoff) return 1;
+	}
+	return 0;
+}
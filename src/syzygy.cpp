@@ -0,0 +1,1397 @@
+/* syzygy.cpp
+* Contains the Syzygy WDL and DTZ tablebase prober, table files are memory mapped from SyzygyPath
+* Theo Kanning
+*/
+
+#include "globals.h"
+#include "stdio.h"
+#include "string.h"
+#include "stdlib.h"
+#include "windows.h"
+
+using namespace std;
+
+/* Follows the table format and probing code published with the Syzygy tables by Ronald de Man
+WDL values for the side to move: -2 loss, -1 loss saved by the 50 move rule, 0 draw, 1 win spoiled by the 50 move rule, 2 win
+DTZ values count plies to the next capture or pawn move, with 100 added when the 50 move rule changes the result
+Tables are found when the path is set but each file is only mapped the first time a probe needs it */
+
+#define TB_PIECES			6 //Largest tables supported, 7 piece tables use a wider dtz map
+#define TB_MAX_TABLES		1024 //Enough for every table up to 6 pieces
+#define TB_HASH_SIZE		4096 //Power of two, holds both material keys of every table
+#define TB_PATH_LENGTH		1024
+#define WDL_SUFFIX			".rtbw"
+#define DTZ_SUFFIX			".rtbz"
+
+static const unsigned char wdl_magic[4] = { 0x71, 0xe8, 0x23, 0x5d };
+static const unsigned char dtz_magic[4] = { 0xd7, 0x66, 0x0c, 0xa5 };
+
+typedef struct
+{
+	const unsigned char *index_table; //6 bytes per entry, block number and position in it
+	const unsigned char *size_table; //16 bit value count of each block, minus one
+	const unsigned char *data; //Compressed blocks
+	const unsigned char *offset; //16 bit first symbol of each code length
+	const unsigned char *sympat; //Symbol pairs, 3 bytes each
+	unsigned char *symlen; //Number of values each symbol expands to, minus one
+	U64 *base; //Lowest left aligned code of each code length
+	int block_size; //Log2 bytes per block
+	int idx_bits; //Log2 positions per index entry, 0 if the table holds one value
+	int min_len; //Shortest code length, or the value of a one value table
+}TB_PAIRS_STRUCT;
+
+typedef struct
+{
+	TB_PAIRS_STRUCT *pairs;
+	int factor[TB_PIECES]; //Index multiplier of each group of pieces
+	unsigned char pieces[TB_PIECES]; //Table piece codes in index order, 1-6 white pawn to king and 9-14 black
+	unsigned char norm[TB_PIECES]; //Size of the group starting at each piece
+}TB_ENCODING_STRUCT;
+
+typedef struct
+{
+	HANDLE file;
+	HANDLE mapping;
+	const unsigned char *data;
+}TB_FILE_STRUCT;
+
+typedef struct
+{
+	char name[16]; //Material as in the file name, like KRPvKR
+	U64 key; //Material key with the first side in the name as white
+	U64 key2; //Material key with colors swapped
+	int num; //Pieces including kings
+	int symmetric; //Both sides have the same material, only white to move is stored
+	int has_pawns;
+	int unique_pieces; //Three or more pieces are alone of their kind, these are indexed together
+	int pawns[2]; //Pawns of the leading color, then of the other color
+
+	std::atomic<int> wdl_ready; //0 until first probed, then 1 if mapped or -1 if the file could not be used
+	std::atomic<int> dtz_ready;
+	TB_FILE_STRUCT wdl_file;
+	TB_FILE_STRUCT dtz_file;
+
+	TB_ENCODING_STRUCT wdl[4][2]; //Per leading pawn file and side to move, tables without pawns only use file 0
+	TB_ENCODING_STRUCT dtz[4]; //Dtz tables store one side to move
+	int dtz_flags[4];
+	const unsigned char *dtz_map; //Maps stored values back to dtz for each wdl result
+	int dtz_map_idx[4][4];
+}TB_ENTRY_STRUCT;
+
+static TB_ENTRY_STRUCT tb_tables[TB_MAX_TABLES];
+static int tb_num_tables = 0;
+static TB_ENTRY_STRUCT *tb_hash[TB_HASH_SIZE];
+static U64 tb_hash_keys[TB_HASH_SIZE];
+static char tb_path[TB_PATH_LENGTH];
+static std::mutex tb_lock; //Held while a table is mapped
+
+int tb_largest = 0; //Pieces in the largest table found
+int tb_cardinality = 0; //Pieces at or below which the search probes, set for each search
+
+/***** Index Tables *****/
+
+static int binomial[TB_PIECES][64]; //binomial[k][n] is n choose k
+static int triangle[64]; //Squares of the a1-d1-d4 triangle, those below the diagonal first
+static int triangle_squares[10];
+static int lower[64]; //Squares below the a1-h8 diagonal
+static int kk_index[10][64]; //Legal king pairs with the first king in the triangle
+static int flap[64]; //Leading pawn squares, one file pair after another from rank 2
+static int ptwist[64]; //Pawn squares in the order other leading pawns are counted
+static int pawn_index[TB_PIECES - 1][24];
+static int pawn_factor[TB_PIECES - 1][4];
+
+static const int wdl_to_map[5] = { 1, 3, 0, 2, 0 };
+static const int pa_flags[5] = { 8, 0, 0, 0, 4 };
+static const int wdl_to_dtz[5] = { -1, -101, 0, 101, 1 };
+
+//Returns 1 above the a1-h8 diagonal, -1 below and 0 on it
+static inline int Off_Diagonal(int sq)
+{
+	return (GET_RANK(sq) > GET_FILE(sq)) - (GET_RANK(sq) < GET_FILE(sq));
+}
+
+static void Init_Index_Tables(void)
+{
+	int code, sq, f, r;
+	int diagonal_pairs[64][2];
+	int num_diagonal_pairs = 0;
+
+	for (int k = 0; k < TB_PIECES; k++)
+	{
+		for (int n = 0; n < 64; n++)
+		{
+			if (k == 0) binomial[k][n] = 1;
+			else if (n == 0) binomial[k][n] = 0;
+			else binomial[k][n] = binomial[k - 1][n - 1] + binomial[k][n - 1];
+		}
+	}
+
+	//Squares below the diagonal come first so a piece on it can be told apart
+	code = 0;
+	for (sq = 0; sq < 64; sq++) if (GET_FILE(sq) <= FILE_D && Off_Diagonal(sq) < 0) triangle_squares[code] = sq, triangle[sq] = code++;
+	for (sq = 0; sq < 64; sq++) if (GET_FILE(sq) <= FILE_D && Off_Diagonal(sq) == 0) triangle_squares[code] = sq, triangle[sq] = code++;
+
+	code = 0;
+	for (sq = 0; sq < 64; sq++) if (Off_Diagonal(sq) < 0) lower[sq] = code++;
+
+	//A first king on the diagonal keeps the second on or below it, pairs with both on it are numbered last
+	code = 0;
+	for (int t = 0; t < 10; t++)
+	{
+		int king = triangle_squares[t];
+		for (sq = 0; sq < 64; sq++)
+		{
+			kk_index[t][sq] = -1;
+			if (sq == king || GET_BIT(king_attack_masks[king], sq)) continue;
+			if (!Off_Diagonal(king) && Off_Diagonal(sq) > 0) continue;
+
+			if (!Off_Diagonal(king) && !Off_Diagonal(sq))
+			{
+				diagonal_pairs[num_diagonal_pairs][0] = t;
+				diagonal_pairs[num_diagonal_pairs++][1] = sq;
+			}
+			else kk_index[t][sq] = code++;
+		}
+	}
+	for (int i = 0; i < num_diagonal_pairs; i++) kk_index[diagonal_pairs[i][0]][diagonal_pairs[i][1]] = code++;
+	ASSERT(code == 462);
+
+	for (f = FILE_A; f <= FILE_D; f++)
+	{
+		for (r = RANK_2; r <= RANK_7; r++)
+		{
+			sq = RANK_FILE_TO_SQUARE(r, f);
+			flap[sq] = flap[sq ^ 7] = 6 * f + r - RANK_2;
+			ptwist[sq] = 47 - 12 * f - 2 * (r - RANK_2);
+			ptwist[sq ^ 7] = ptwist[sq] - 1;
+		}
+	}
+
+	for (int t = 0; t < TB_PIECES - 1; t++)
+	{
+		for (f = FILE_A; f <= FILE_D; f++)
+		{
+			int s = 0;
+			for (r = RANK_2; r <= RANK_7; r++)
+			{
+				sq = RANK_FILE_TO_SQUARE(r, f);
+				pawn_index[t][flap[sq]] = s;
+				s += binomial[t][ptwist[sq]];
+			}
+			pawn_factor[t][f] = s;
+		}
+	}
+}
+
+/***** Reading Files *****/
+
+static inline int Read_LE16(const unsigned char *p)
+{
+	return p[0] | (p[1] << 8);
+}
+
+static inline unsigned int Read_LE32(const unsigned char *p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned int)p[3] << 24);
+}
+
+static inline unsigned int Read_BE32(const unsigned char *p)
+{
+	return ((unsigned int)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+static inline U64 Read_BE64(const unsigned char *p)
+{
+	return ((U64)Read_BE32(p) << 32) | Read_BE32(p + 4);
+}
+
+//Opens a table in the first SyzygyPath directory that has it, paths are separated by ';'
+//Maps the file into tb_file, or only tests that it exists if tb_file is NULL
+static int Map_Table_File(const char *name, const char *suffix, TB_FILE_STRUCT *tb_file)
+{
+	char path[TB_PATH_LENGTH];
+	const char *dir = tb_path;
+
+	while (*dir)
+	{
+		int length = (int)strcspn(dir, ";");
+
+		if (length > 0 && length + strlen(name) + strlen(suffix) + 2 < TB_PATH_LENGTH)
+		{
+			sprintf_s(path, "%.*s/%s%s", length, dir, name, suffix);
+
+			HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, NULL);
+			if (file != INVALID_HANDLE_VALUE)
+			{
+				if (tb_file == NULL)
+				{
+					CloseHandle(file);
+					return 1;
+				}
+
+				HANDLE mapping = CreateFileMapping(file, NULL, PAGE_READONLY, 0, 0, NULL);
+				const unsigned char *data = mapping ? (const unsigned char *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+				if (data == NULL)
+				{
+					if (mapping) CloseHandle(mapping);
+					CloseHandle(file);
+					printf("info string Could not map %s\n", path);
+					return 0;
+				}
+
+				tb_file->file = file;
+				tb_file->mapping = mapping;
+				tb_file->data = data;
+				return 1;
+			}
+		}
+
+		dir += length;
+		if (*dir == ';') dir++;
+	}
+
+	return 0;
+}
+
+static void Unmap_Table_File(TB_FILE_STRUCT *tb_file)
+{
+	if (tb_file->data == NULL) return;
+
+	UnmapViewOfFile((void *)tb_file->data);
+	CloseHandle(tb_file->mapping);
+	CloseHandle(tb_file->file);
+	tb_file->data = NULL;
+}
+
+/***** Table Setup *****/
+
+//Returns n choose k for groups of k identical pieces on n squares
+static U64 Subfactor(int k, int n)
+{
+	U64 f = n, l = 1;
+
+	for (int i = 1; i < k; i++)
+	{
+		f *= n - i;
+		l *= i + 1;
+	}
+
+	return f / l;
+}
+
+//Splits the pieces into the groups they are indexed in, identical pieces share a group
+static void Set_Norm(TB_ENTRY_STRUCT *entry, TB_ENCODING_STRUCT *enc)
+{
+	int i;
+
+	memset(enc->norm, 0, sizeof(enc->norm));
+
+	if (entry->has_pawns)
+	{
+		enc->norm[0] = entry->pawns[0];
+		if (entry->pawns[1]) enc->norm[entry->pawns[0]] = entry->pawns[1];
+		i = entry->pawns[0] + entry->pawns[1];
+	}
+	else
+	{
+		enc->norm[0] = entry->unique_pieces ? 3 : 2;
+		i = enc->norm[0];
+	}
+
+	for (; i < entry->num; i += enc->norm[i])
+	{
+		for (int j = i; j < entry->num && enc->pieces[j] == enc->pieces[i]; j++) enc->norm[i]++;
+	}
+}
+
+//Sets the index multiplier of each group, order is the position of the leading group, returns the table size
+static U64 Calc_Factors_Piece(TB_ENTRY_STRUCT *entry, TB_ENCODING_STRUCT *enc, int order)
+{
+	int n = 64 - enc->norm[0];
+	U64 f = 1;
+
+	for (int i = enc->norm[0], k = 0; i < entry->num || k == order; k++)
+	{
+		if (k == order)
+		{
+			enc->factor[0] = (int)f;
+			f *= entry->unique_pieces ? 31332 : 462;
+		}
+		else
+		{
+			enc->factor[i] = (int)f;
+			f *= Subfactor(enc->norm[i], n);
+			n -= enc->norm[i];
+			i += enc->norm[i];
+		}
+	}
+
+	return f;
+}
+
+//Same for pawn tables, order2 is the position of the other color's pawns, 0x0f if there are none
+static U64 Calc_Factors_Pawn(TB_ENTRY_STRUCT *entry, TB_ENCODING_STRUCT *enc, int order, int order2, int file)
+{
+	int i = enc->norm[0];
+	if (order2 < 0x0f) i += enc->norm[i];
+	int n = 64 - i;
+	U64 f = 1;
+
+	for (int k = 0; i < entry->num || k == order || k == order2; k++)
+	{
+		if (k == order)
+		{
+			enc->factor[0] = (int)f;
+			f *= pawn_factor[enc->norm[0] - 1][file];
+		}
+		else if (k == order2)
+		{
+			enc->factor[enc->norm[0]] = (int)f;
+			f *= Subfactor(enc->norm[enc->norm[0]], 48 - enc->norm[0]);
+		}
+		else
+		{
+			enc->factor[i] = (int)f;
+			f *= Subfactor(enc->norm[i], n);
+			n -= enc->norm[i];
+			i += enc->norm[i];
+		}
+	}
+
+	return f;
+}
+
+//Reads the piece order of one side to move from a table header, shift 0 for the first side and 4 for the second
+static U64 Setup_Pieces(TB_ENTRY_STRUCT *entry, TB_ENCODING_STRUCT *enc, const unsigned char *data, int shift, int file)
+{
+	int first = entry->has_pawns ? 1 + (entry->pawns[1] > 0) : 1;
+
+	for (int i = 0; i < entry->num; i++) enc->pieces[i] = (data[i + first] >> shift) & 0x0f;
+	Set_Norm(entry, enc);
+
+	int order = (data[0] >> shift) & 0x0f;
+	if (!entry->has_pawns) return Calc_Factors_Piece(entry, enc, order);
+
+	int order2 = entry->pawns[1] ? (data[1] >> shift) & 0x0f : 0x0f;
+	return Calc_Factors_Pawn(entry, enc, order, order2, file);
+}
+
+static void Calc_Symlen(TB_PAIRS_STRUCT *d, int s, char *done)
+{
+	const unsigned char *w = d->sympat + 3 * s;
+	int s2 = (w[2] << 4) | (w[1] >> 4);
+
+	if (s2 == 0x0fff) d->symlen[s] = 0; //A single value
+	else
+	{
+		int s1 = ((w[1] & 0x0f) << 8) | w[0];
+		if (!done[s1]) Calc_Symlen(d, s1, done);
+		if (!done[s2]) Calc_Symlen(d, s2, done);
+		d->symlen[s] = d->symlen[s1] + d->symlen[s2] + 1;
+	}
+	done[s] = 1;
+}
+
+//Reads the compression header of one table, data is moved past it
+//size gets the bytes used by the index table, size table and blocks, which follow all headers
+static TB_PAIRS_STRUCT *Setup_Pairs(const unsigned char **data_ptr, U64 tb_size, U64 size[3], int *flags, int wdl)
+{
+	const unsigned char *data = *data_ptr;
+	TB_PAIRS_STRUCT *d = (TB_PAIRS_STRUCT *)calloc(1, sizeof(TB_PAIRS_STRUCT));
+
+	*flags = data[0];
+	if (data[0] & 0x80) //Every position has the same value
+	{
+		d->min_len = wdl ? data[1] : 0;
+		*data_ptr = data + 2;
+		size[0] = size[1] = size[2] = 0;
+		return d;
+	}
+
+	d->block_size = data[1];
+	d->idx_bits = data[2];
+	unsigned int real_num_blocks = Read_LE32(data + 4);
+	unsigned int num_blocks = real_num_blocks + data[3];
+	int max_len = data[8];
+	int min_len = data[9];
+	int h = max_len - min_len + 1;
+	int num_syms = Read_LE16(data + 10 + 2 * h);
+
+	d->offset = data + 10;
+	d->sympat = data + 12 + 2 * h;
+	d->min_len = min_len;
+	d->symlen = (unsigned char *)calloc(num_syms, 1);
+	d->base = (U64 *)calloc(h, sizeof(U64));
+	*data_ptr = data + 12 + 2 * h + 3 * num_syms + (num_syms & 1);
+
+	U64 num_indices = (tb_size + (1ULL << d->idx_bits) - 1) >> d->idx_bits;
+	size[0] = 6ULL * num_indices;
+	size[1] = 2ULL * num_blocks;
+	size[2] = (U64)real_num_blocks << d->block_size;
+
+	char *done = (char *)calloc(num_syms, 1);
+	for (int i = 0; i < num_syms; i++)
+	{
+		if (!done[i]) Calc_Symlen(d, i, done);
+	}
+	free(done);
+
+	//Canonical huffman codes, base[i] is the lowest code of length min_len + i
+	d->base[h - 1] = 0;
+	for (int i = h - 2; i >= 0; i--) d->base[i] = (d->base[i + 1] + Read_LE16(d->offset + 2 * i) - Read_LE16(d->offset + 2 * i + 2)) / 2;
+	for (int i = 0; i < h; i++) d->base[i] <<= 64 - (min_len + i);
+
+	return d;
+}
+
+static void Free_Pairs(TB_PAIRS_STRUCT *d)
+{
+	if (d == NULL) return;
+
+	free(d->symlen);
+	free(d->base);
+	free(d);
+}
+
+//Moves data forward to a multiple of align bytes from the start of the file
+static inline const unsigned char *Align(const unsigned char *data, const unsigned char *start, int align)
+{
+	return data + ((align - (data - start) % align) % align);
+}
+
+static int Load_WDL(TB_ENTRY_STRUCT *entry)
+{
+	TB_FILE_STRUCT *tb_file = &entry->wdl_file;
+	U64 tb_size[4][2];
+	U64 size[4][2][3];
+	int flags;
+
+	if (!Map_Table_File(entry->name, WDL_SUFFIX, tb_file)) return 0;
+
+	const unsigned char *data = tb_file->data;
+	if (memcmp(data, wdl_magic, 4))
+	{
+		printf("info string Corrupted table %s%s\n", entry->name, WDL_SUFFIX);
+		Unmap_Table_File(tb_file);
+		return 0;
+	}
+
+	int sides = (data[4] & 0x01) ? 2 : 1; //Split tables store black to move separately
+	int files = entry->has_pawns ? 4 : 1;
+	data += 5;
+
+	for (int f = 0; f < files; f++)
+	{
+		tb_size[f][0] = Setup_Pieces(entry, &entry->wdl[f][0], data, 0, f);
+		tb_size[f][1] = Setup_Pieces(entry, &entry->wdl[f][1], data, 4, f);
+		data += entry->num + (entry->has_pawns ? 1 + (entry->pawns[1] > 0) : 1);
+	}
+	data = Align(data, tb_file->data, 2);
+
+	for (int f = 0; f < files; f++)
+	{
+		for (int side = 0; side < sides; side++) entry->wdl[f][side].pairs = Setup_Pairs(&data, tb_size[f][side], size[f][side], &flags, 1);
+	}
+	for (int f = 0; f < files; f++)
+	{
+		for (int side = 0; side < sides; side++)
+		{
+			entry->wdl[f][side].pairs->index_table = data;
+			data += size[f][side][0];
+		}
+	}
+	for (int f = 0; f < files; f++)
+	{
+		for (int side = 0; side < sides; side++)
+		{
+			entry->wdl[f][side].pairs->size_table = data;
+			data += size[f][side][1];
+		}
+	}
+	for (int f = 0; f < files; f++)
+	{
+		for (int side = 0; side < sides; side++)
+		{
+			data = Align(data, tb_file->data, 64);
+			entry->wdl[f][side].pairs->data = data;
+			data += size[f][side][2];
+		}
+	}
+
+	return 1;
+}
+
+static int Load_DTZ(TB_ENTRY_STRUCT *entry)
+{
+	TB_FILE_STRUCT *tb_file = &entry->dtz_file;
+	U64 tb_size[4];
+	U64 size[4][3];
+
+	if (!Map_Table_File(entry->name, DTZ_SUFFIX, tb_file)) return 0;
+
+	const unsigned char *data = tb_file->data;
+	if (memcmp(data, dtz_magic, 4))
+	{
+		printf("info string Corrupted table %s%s\n", entry->name, DTZ_SUFFIX);
+		Unmap_Table_File(tb_file);
+		return 0;
+	}
+
+	int files = entry->has_pawns ? 4 : 1;
+	data += 5;
+
+	for (int f = 0; f < files; f++)
+	{
+		tb_size[f] = Setup_Pieces(entry, &entry->dtz[f], data, 0, f);
+		data += entry->num + (entry->has_pawns ? 1 + (entry->pawns[1] > 0) : 1);
+	}
+	data = Align(data, tb_file->data, 2);
+
+	for (int f = 0; f < files; f++)
+	{
+		entry->dtz[f].pairs = Setup_Pairs(&data, tb_size[f], size[f], &entry->dtz_flags[f], 0);
+		if (entry->dtz_flags[f] & 0x10) //16 bit maps only appear in 7 piece tables
+		{
+			printf("info string Unsupported table %s%s\n", entry->name, DTZ_SUFFIX);
+			for (int i = 0; i <= f; i++) Free_Pairs(entry->dtz[i].pairs), entry->dtz[i].pairs = NULL;
+			Unmap_Table_File(tb_file);
+			return 0;
+		}
+	}
+
+	entry->dtz_map = data;
+	for (int f = 0; f < files; f++)
+	{
+		if (entry->dtz_flags[f] & 0x02)
+		{
+			for (int i = 0; i < 4; i++)
+			{
+				entry->dtz_map_idx[f][i] = (int)(data + 1 - entry->dtz_map);
+				data += 1 + data[0];
+			}
+		}
+	}
+	data = Align(data, tb_file->data, 2);
+
+	for (int f = 0; f < files; f++)
+	{
+		entry->dtz[f].pairs->index_table = data;
+		data += size[f][0];
+	}
+	for (int f = 0; f < files; f++)
+	{
+		entry->dtz[f].pairs->size_table = data;
+		data += size[f][1];
+	}
+	for (int f = 0; f < files; f++)
+	{
+		data = Align(data, tb_file->data, 64);
+		entry->dtz[f].pairs->data = data;
+		data += size[f][2];
+	}
+
+	return 1;
+}
+
+//Maps a table file the first time it is probed, returns 1 if it can be read
+static int Table_Ready(TB_ENTRY_STRUCT *entry, int dtz)
+{
+	std::atomic<int> *ready = dtz ? &entry->dtz_ready : &entry->wdl_ready;
+
+	if (*ready) return *ready > 0;
+
+	std::lock_guard<std::mutex> lock(tb_lock);
+	if (!*ready) *ready = (dtz ? Load_DTZ(entry) : Load_WDL(entry)) ? 1 : -1;
+
+	return *ready > 0;
+}
+
+/***** Table List *****/
+
+//Material key from piece counts, four bits for each piece type other than kings
+static U64 Material_Key(const int counts[13])
+{
+	U64 key = 0;
+
+	for (int piece = wP; piece <= bK; piece++)
+	{
+		if (!IS_KING(piece)) key |= (U64)counts[piece] << (4 * piece);
+	}
+	return key;
+}
+
+static U64 Board_Material_Key(BOARD_STRUCT *board)
+{
+	return Material_Key(board->piece_num);
+}
+
+static TB_ENTRY_STRUCT *Find_Table(U64 key)
+{
+	int index = (int)((key * 0x9e3779b97f4a7c15ULL) >> 52) & (TB_HASH_SIZE - 1);
+
+	while (tb_hash[index])
+	{
+		if (tb_hash_keys[index] == key) return tb_hash[index];
+		index = (index + 1) & (TB_HASH_SIZE - 1);
+	}
+	return NULL;
+}
+
+static void Add_To_Hash(TB_ENTRY_STRUCT *entry, U64 key)
+{
+	int index = (int)((key * 0x9e3779b97f4a7c15ULL) >> 52) & (TB_HASH_SIZE - 1);
+
+	while (tb_hash[index]) index = (index + 1) & (TB_HASH_SIZE - 1);
+	tb_hash[index] = entry;
+	tb_hash_keys[index] = key;
+}
+
+//Adds a table if its wdl file is in the path, name is like KRPvKR
+static void Add_Table(const char *name)
+{
+	static const char piece_chars[] = "PNBRQK";
+	int counts[13] = { 0 };
+	int swapped[13] = { 0 };
+	int side = WHITE;
+
+	for (const char *c = name; *c; c++)
+	{
+		if (*c == 'v') side = BLACK;
+		else counts[(int)(strchr(piece_chars, *c) - piece_chars) + 1 + 6 * side]++;
+	}
+	for (int piece = wP; piece <= bK; piece++) swapped[piece] = counts[(piece <= wK) ? piece + 6 : piece - 6];
+
+	if (tb_num_tables >= TB_MAX_TABLES || Find_Table(Material_Key(counts))) return;
+	if (!Map_Table_File(name, WDL_SUFFIX, NULL)) return;
+
+	TB_ENTRY_STRUCT *entry = &tb_tables[tb_num_tables++];
+	memcpy(entry->name, name, strlen(name) + 1);
+	entry->key = Material_Key(counts);
+	entry->key2 = Material_Key(swapped);
+	entry->symmetric = (entry->key == entry->key2);
+	entry->has_pawns = (counts[wP] + counts[bP] > 0);
+	entry->wdl_ready = 0;
+	entry->dtz_ready = 0;
+
+	entry->num = 0;
+	int unique = 0;
+	for (int piece = wP; piece <= bK; piece++)
+	{
+		entry->num += counts[piece];
+		if (counts[piece] == 1) unique++;
+	}
+	entry->unique_pieces = (unique >= 3);
+
+	//The color with fewer pawns leads, white if they have the same
+	entry->pawns[0] = counts[wP];
+	entry->pawns[1] = counts[bP];
+	if (counts[bP] > 0 && (counts[wP] == 0 || counts[bP] < counts[wP]))
+	{
+		entry->pawns[0] = counts[bP];
+		entry->pawns[1] = counts[wP];
+	}
+
+	if (entry->num > tb_largest) tb_largest = entry->num;
+
+	Add_To_Hash(entry, entry->key);
+	if (entry->key2 != entry->key) Add_To_Hash(entry, entry->key2);
+}
+
+//Frees every table and forgets the path
+static void Free_Tables(void)
+{
+	for (int i = 0; i < tb_num_tables; i++)
+	{
+		TB_ENTRY_STRUCT *entry = &tb_tables[i];
+
+		for (int f = 0; f < 4; f++)
+		{
+			Free_Pairs(entry->wdl[f][0].pairs);
+			Free_Pairs(entry->wdl[f][1].pairs);
+			Free_Pairs(entry->dtz[f].pairs);
+		}
+		Unmap_Table_File(&entry->wdl_file);
+		Unmap_Table_File(&entry->dtz_file);
+		memset(entry->wdl, 0, sizeof(entry->wdl));
+		memset(entry->dtz, 0, sizeof(entry->dtz));
+	}
+
+	tb_num_tables = 0;
+	tb_largest = 0;
+	tb_cardinality = 0;
+	memset(tb_hash, 0, sizeof(tb_hash));
+	memset(tb_hash_keys, 0, sizeof(tb_hash_keys));
+	tb_path[0] = '\0';
+}
+
+//Adds every combination of up to TB_PIECES - 2 pieces to one side, names list pieces from queen to pawn
+static void Add_Side_Names(char names[][TB_PIECES], int *num, char *current, int length, int first)
+{
+	static const char order[] = "QRBNP";
+
+	current[length] = '\0';
+	memcpy(names[(*num)++], current, length + 1);
+	if (length == TB_PIECES - 2) return;
+
+	for (int i = first; i < 5; i++)
+	{
+		current[length] = order[i];
+		Add_Side_Names(names, num, current, length + 1, i);
+	}
+}
+
+//Finds the tables in path, a list of directories separated by ';'
+//Files are only mapped when first probed, "<empty>" or an empty path turns probing off
+void TB_Init(char *path)
+{
+	static int index_tables_ready = 0;
+	char names[256][TB_PIECES];
+	char current[TB_PIECES];
+	char name[16];
+	int num_names = 0;
+
+	if (!index_tables_ready)
+	{
+		Init_Index_Tables();
+		index_tables_ready = 1;
+	}
+
+	Free_Tables();
+	if (path == NULL || path[0] == '\0' || !strcmp(path, "<empty>") || strlen(path) >= TB_PATH_LENGTH) return;
+	memcpy(tb_path, path, strlen(path) + 1);
+
+	Add_Side_Names(names, &num_names, current, 0, 0);
+
+	for (int i = 0; i < num_names; i++)
+	{
+		for (int j = 0; j < num_names; j++)
+		{
+			int pieces = 2 + (int)strlen(names[i]) + (int)strlen(names[j]);
+			if (pieces == 2 || pieces > TB_PIECES) continue;
+
+			sprintf_s(name, "K%svK%s", names[i], names[j]);
+			Add_Table(name);
+		}
+	}
+
+	printf("info string Found %d tablebases, up to %d pieces\n", tb_num_tables, tb_largest);
+}
+
+/***** Encoding *****/
+
+static const int file_to_file[8] = { 0, 1, 2, 3, 3, 2, 1, 0 };
+
+static inline int Flip_Diagonal(int sq)
+{
+	return ((sq >> 3) | (sq << 3)) & 63;
+}
+
+static inline void Swap(int *a, int *b)
+{
+	int temp = *a;
+	*a = *b;
+	*b = temp;
+}
+
+//Adds the index of each group of identical pieces after the first, starting at piece i
+static U64 Encode_Groups(TB_ENTRY_STRUCT *entry, TB_ENCODING_STRUCT *enc, int *pos, int i)
+{
+	U64 idx = 0;
+
+	while (i < entry->num)
+	{
+		int t = enc->norm[i];
+
+		for (int j = i; j < i + t; j++)
+		{
+			for (int k = j + 1; k < i + t; k++) if (pos[j] > pos[k]) Swap(&pos[j], &pos[k]);
+		}
+
+		//Squares taken by earlier groups are skipped
+		int s = 0;
+		for (int m = i; m < i + t; m++)
+		{
+			int skipped = 0;
+			for (int l = 0; l < i; l++) skipped += (pos[m] > pos[l]);
+			s += binomial[m - i + 1][pos[m] - skipped];
+		}
+		idx += (U64)s * enc->factor[i];
+		i += t;
+	}
+
+	return idx;
+}
+
+//Returns the index of a position without pawns, the board is turned so the first piece is in the a1-d1-d4 triangle
+static U64 Encode_Piece(TB_ENTRY_STRUCT *entry, TB_ENCODING_STRUCT *enc, int *pos)
+{
+	int n = entry->num;
+	int i, j;
+	U64 idx;
+
+	if (pos[0] & 0x04) for (i = 0; i < n; i++) pos[i] ^= 0x07;
+	if (pos[0] & 0x20) for (i = 0; i < n; i++) pos[i] ^= 0x38;
+
+	//Pieces on the diagonal do not decide the flip, the first one off it is put below
+	for (i = 0; i < n; i++) if (Off_Diagonal(pos[i])) break;
+	if (i < (entry->unique_pieces ? 3 : 2) && Off_Diagonal(pos[i]) > 0)
+	{
+		for (i = 0; i < n; i++) pos[i] = Flip_Diagonal(pos[i]);
+	}
+
+	if (entry->unique_pieces)
+	{
+		i = (pos[1] > pos[0]);
+		j = (pos[2] > pos[0]) + (pos[2] > pos[1]);
+
+		if (Off_Diagonal(pos[0])) idx = triangle[pos[0]] * 63 * 62 + (pos[1] - i) * 62 + (pos[2] - j);
+		else if (Off_Diagonal(pos[1])) idx = 6 * 63 * 62 + GET_RANK(pos[0]) * 28 * 62 + lower[pos[1]] * 62 + pos[2] - j;
+		else if (Off_Diagonal(pos[2])) idx = 6 * 63 * 62 + 4 * 28 * 62 + GET_RANK(pos[0]) * 7 * 28 + (GET_RANK(pos[1]) - i) * 28 + lower[pos[2]];
+		else idx = 6 * 63 * 62 + 4 * 28 * 62 + 4 * 7 * 28 + GET_RANK(pos[0]) * 7 * 6 + (GET_RANK(pos[1]) - i) * 6 + (GET_RANK(pos[2]) - j);
+		i = 3;
+	}
+	else
+	{
+		idx = kk_index[triangle[pos[0]]][pos[1]];
+		i = 2;
+	}
+
+	return idx * enc->factor[0] + Encode_Groups(entry, enc, pos, i);
+}
+
+//Returns the index of a position with pawns, the leading pawn must be first and on files a to d after mirroring
+static U64 Encode_Pawn(TB_ENTRY_STRUCT *entry, TB_ENCODING_STRUCT *enc, int *pos)
+{
+	int n = entry->num;
+	int i, j;
+	U64 idx;
+
+	if (pos[0] & 0x04) for (i = 0; i < n; i++) pos[i] ^= 0x07;
+
+	for (i = 1; i < entry->pawns[0]; i++)
+	{
+		for (j = i + 1; j < entry->pawns[0]; j++) if (ptwist[pos[i]] < ptwist[pos[j]]) Swap(&pos[i], &pos[j]);
+	}
+
+	int t = entry->pawns[0] - 1;
+	idx = pawn_index[t][flap[pos[0]]];
+	for (i = t; i > 0; i--) idx += binomial[t - i + 1][ptwist[pos[i]]];
+	idx *= enc->factor[0];
+
+	//Pawns of the other color are on the 48 squares from a2 to h7
+	i = entry->pawns[0];
+	t = i + entry->pawns[1];
+	if (t > i)
+	{
+		for (j = i; j < t; j++)
+		{
+			for (int k = j + 1; k < t; k++) if (pos[j] > pos[k]) Swap(&pos[j], &pos[k]);
+		}
+
+		int s = 0;
+		for (int m = i; m < t; m++)
+		{
+			int skipped = 0;
+			for (int k = 0; k < i; k++) skipped += (pos[m] > pos[k]);
+			s += binomial[m - i + 1][pos[m] - skipped - 8];
+		}
+		idx += (U64)s * enc->factor[i];
+		i = t;
+	}
+
+	return idx + Encode_Groups(entry, enc, pos, i);
+}
+
+//Moves the leading pawn closest to the a-file and 2nd rank first, returns the table file it selects
+static int Leading_Pawn_File(TB_ENTRY_STRUCT *entry, int *pos)
+{
+	for (int i = 1; i < entry->pawns[0]; i++)
+	{
+		if (flap[pos[0]] > flap[pos[i]]) Swap(&pos[0], &pos[i]);
+	}
+	return file_to_file[GET_FILE(pos[0])];
+}
+
+/***** Decompression *****/
+
+//Returns the value stored at idx
+static int Decompress_Pairs(TB_PAIRS_STRUCT *d, U64 idx)
+{
+	if (!d->idx_bits) return d->min_len;
+
+	unsigned int main_idx = (unsigned int)(idx >> d->idx_bits);
+	int lit_idx = (int)(idx & ((1ULL << d->idx_bits) - 1)) - (1 << (d->idx_bits - 1));
+	unsigned int block = Read_LE32(d->index_table + 6 * main_idx);
+	lit_idx += Read_LE16(d->index_table + 6 * main_idx + 4);
+
+	//Index entries point into the middle of a block, walk to the block holding the value
+	if (lit_idx < 0)
+	{
+		while (lit_idx < 0) lit_idx += Read_LE16(d->size_table + 2 * (--block)) + 1;
+	}
+	else
+	{
+		while (lit_idx > Read_LE16(d->size_table + 2 * block)) lit_idx -= Read_LE16(d->size_table + 2 * (block++)) + 1;
+	}
+
+	const unsigned char *ptr = d->data + ((U64)block << d->block_size);
+	int m = d->min_len;
+	int sym, bit_count = 0; //Bits used from the bottom of code
+	U64 code = Read_BE64(ptr);
+	ptr += 8;
+
+	while (1)
+	{
+		int l = m;
+		while (code < d->base[l - m]) l++;
+		sym = Read_LE16(d->offset + 2 * (l - m)) + (int)((code - d->base[l - m]) >> (64 - l));
+		if (lit_idx < d->symlen[sym] + 1) break;
+
+		lit_idx -= d->symlen[sym] + 1;
+		code <<= l;
+		bit_count += l;
+		if (bit_count >= 32)
+		{
+			bit_count -= 32;
+			code |= (U64)Read_BE32(ptr) << bit_count;
+			ptr += 4;
+		}
+	}
+
+	//Expand the symbol pairs until a single value is left
+	while (d->symlen[sym] != 0)
+	{
+		const unsigned char *w = d->sympat + 3 * sym;
+		int s1 = ((w[1] & 0x0f) << 8) | w[0];
+
+		if (lit_idx < d->symlen[s1] + 1) sym = s1;
+		else
+		{
+			lit_idx -= d->symlen[s1] + 1;
+			sym = (w[2] << 4) | (w[1] >> 4);
+		}
+	}
+
+	return d->sympat[3 * sym];
+}
+
+/***** Table Probes *****/
+
+//Adds the squares of every piece of one table piece code, returns the next free slot
+static int Add_Squares(BOARD_STRUCT *board, int code, int flip, int mirror, int *pos, int i)
+{
+	U64 temp = board->piece_bitboards[(code & 0x07) + 6 * ((code >> 3) ^ flip)];
+
+	while (temp) pos[i++] = pop_1st_bit(&temp) ^ mirror;
+	return i;
+}
+
+//Looks up the table for the board's material, tables are stored from the view of their first side
+//flip is set if colors must be swapped to match it, and bside is the side to move after that
+static TB_ENTRY_STRUCT *Get_Entry(BOARD_STRUCT *board, int dtz, int *flip, int *bside)
+{
+	U64 key = Board_Material_Key(board);
+	TB_ENTRY_STRUCT *entry = Find_Table(key);
+
+	if (entry == NULL || !Table_Ready(entry, dtz)) return NULL;
+
+	*flip = entry->symmetric ? (board->side == BLACK) : (key != entry->key);
+	*bside = board->side ^ *flip;
+	return entry;
+}
+
+//Returns the wdl value from the table, success is set to 0 if it is not available
+static int Probe_WDL_Table(BOARD_STRUCT *board, int *success)
+{
+	int pos[TB_PIECES];
+	int flip, bside, f = 0, i = 0;
+
+	if (count_1s(board->side_bitboards[BOTH]) == 2) return 0; //Bare kings
+
+	TB_ENTRY_STRUCT *entry = Get_Entry(board, 0, &flip, &bside);
+	if (entry == NULL)
+	{
+		*success = 0;
+		return 0;
+	}
+
+	if (entry->has_pawns)
+	{
+		const int mirror = flip ? 0x38 : 0;
+		i = Add_Squares(board, entry->wdl[0][0].pieces[0], flip, mirror, pos, 0);
+		f = Leading_Pawn_File(entry, pos);
+		TB_ENCODING_STRUCT *enc = &entry->wdl[f][bside];
+		if (enc->pairs == NULL)
+		{
+			*success = 0;
+			return 0;
+		}
+		while (i < entry->num) i = Add_Squares(board, enc->pieces[i], flip, mirror, pos, i);
+		return Decompress_Pairs(enc->pairs, Encode_Pawn(entry, enc, pos)) - 2;
+	}
+
+	TB_ENCODING_STRUCT *enc = &entry->wdl[0][bside];
+	if (enc->pairs == NULL)
+	{
+		*success = 0;
+		return 0;
+	}
+	while (i < entry->num) i = Add_Squares(board, enc->pieces[i], flip, 0, pos, i);
+	return Decompress_Pairs(enc->pairs, Encode_Piece(entry, enc, pos)) - 2;
+}
+
+//Returns the dtz value from the table for a position with the given wdl, without the 50 move rule adjustments
+//Success is 0 if the table is missing and -1 if it only stores the other side to move
+static int Probe_DTZ_Table(BOARD_STRUCT *board, int wdl, int *success)
+{
+	int pos[TB_PIECES];
+	int flip, bside, f = 0, i = 0, value;
+
+	TB_ENTRY_STRUCT *entry = Get_Entry(board, 1, &flip, &bside);
+	if (entry == NULL)
+	{
+		*success = 0;
+		return 0;
+	}
+
+	const int mirror = (entry->has_pawns && flip) ? 0x38 : 0;
+	if (entry->has_pawns)
+	{
+		i = Add_Squares(board, entry->dtz[0].pieces[0], flip, mirror, pos, 0);
+		f = Leading_Pawn_File(entry, pos);
+	}
+
+	TB_ENCODING_STRUCT *enc = &entry->dtz[f];
+	const int flags = entry->dtz_flags[f];
+	if ((flags & 1) != bside && !entry->symmetric)
+	{
+		*success = -1;
+		return 0;
+	}
+
+	while (i < entry->num) i = Add_Squares(board, enc->pieces[i], flip, mirror, pos, i);
+	value = Decompress_Pairs(enc->pairs, entry->has_pawns ? Encode_Pawn(entry, enc, pos) : Encode_Piece(entry, enc, pos));
+
+	if (flags & 2) value = entry->dtz_map[entry->dtz_map_idx[f][wdl_to_map[wdl + 2]] + value];
+	if (!(flags & pa_flags[wdl + 2]) || (wdl & 1)) value *= 2; //Stored in moves rather than plies
+
+	return value;
+}
+
+/***** Search Probes *****/
+
+//Returns 1 if the side to move has a legal move, en passant captures only count if include_ep is set
+static int Has_Legal_Move(BOARD_STRUCT *board, int include_ep)
+{
+	MOVE_LIST_STRUCT move_list;
+
+	Generate_Moves(board, &move_list);
+	for (int i = 0; i < move_list.num; i++)
+	{
+		if ((!include_ep && IS_EP_CAPTURE(move_list.list[i].move)) || !Make_Move(move_list.list[i].move, board)) continue;
+		Take_Move(board);
+		return 1;
+	}
+	return 0;
+}
+
+//Alpha beta over captures, tables do not store positions where a capture is best or forced
+//Success is set to 2 if the result comes from a capture
+static int Probe_AB(BOARD_STRUCT *board, int alpha, int beta, int *success)
+{
+	MOVE_LIST_STRUCT move_list;
+	int value;
+
+	Generate_Capture_Promote_Moves(board, &move_list);
+	for (int i = 0; i < move_list.num; i++)
+	{
+		int move = move_list.list[i].move;
+		if (!IS_CAPTURE(move) || IS_EP_CAPTURE(move) || !Make_Move(move, board)) continue;
+
+		value = -Probe_AB(board, -beta, -alpha, success);
+		Take_Move(board);
+
+		if (*success == 0) return 0;
+		if (value > alpha)
+		{
+			if (value >= beta)
+			{
+				*success = 2;
+				return value;
+			}
+			alpha = value;
+		}
+	}
+
+	value = Probe_WDL_Table(board, success);
+	if (*success == 0) return 0;
+
+	if (alpha >= value)
+	{
+		*success = 1 + (alpha > 0);
+		return alpha;
+	}
+	*success = 1;
+	return value;
+}
+
+//Returns the best wdl of the en passant captures, or -3 if there are none
+static int Probe_EP_Captures(BOARD_STRUCT *board, int *success)
+{
+	MOVE_LIST_STRUCT move_list;
+	int best = -3;
+
+	Generate_Capture_Promote_Moves(board, &move_list);
+	for (int i = 0; i < move_list.num; i++)
+	{
+		int move = move_list.list[i].move;
+		if (!IS_EP_CAPTURE(move) || !Make_Move(move, board)) continue;
+
+		int value = -Probe_AB(board, -2, 2, success);
+		Take_Move(board);
+
+		if (*success == 0) return 0;
+		if (value > best) best = value;
+	}
+
+	return best;
+}
+
+//Returns the wdl value of the position for the side to move, success is 0 if a table is missing
+//The board must have no castle rights and at most tb_largest pieces
+int TB_Probe_WDL(BOARD_STRUCT *board, int *success)
+{
+	*success = 1;
+	int value = Probe_AB(board, -2, 2, success);
+
+	if (board->ep == NO_SQUARE || !*success) return *success ? value : 0;
+
+	//An en passant capture is only played if it is better, or if it is the only legal move
+	int ep_value = Probe_EP_Captures(board, success);
+	if (!*success) return 0;
+
+	if (ep_value > -3)
+	{
+		if (ep_value >= value) value = ep_value;
+		else if (value == 0 && !Has_Legal_Move(board, 0)) value = ep_value;
+	}
+	return value;
+}
+
+//Dtz without en passant captures
+static int Probe_DTZ_No_EP(BOARD_STRUCT *board, int *success)
+{
+	MOVE_LIST_STRUCT move_list;
+	int wdl, dtz;
+
+	wdl = Probe_AB(board, -2, 2, success);
+	if (*success == 0 || wdl == 0) return 0;
+	if (*success == 2) return (wdl == 2) ? 1 : 101; //Winning capture, the counter resets now
+
+	Generate_Moves(board, &move_list);
+
+	//A winning pawn push also resets the counter
+	if (wdl > 0)
+	{
+		for (int i = 0; i < move_list.num; i++)
+		{
+			int move = move_list.list[i].move;
+			if (!IS_PAWN(GET_PIECE(move)) || IS_CAPTURE(move) || !Make_Move(move, board)) continue;
+
+			int value = -Probe_AB(board, -2, -wdl + 1, success);
+			Take_Move(board);
+
+			if (*success == 0) return 0;
+			if (value == wdl) return (value == 2) ? 1 : 101;
+		}
+	}
+
+	dtz = 1 + Probe_DTZ_Table(board, wdl, success);
+	if (*success >= 0)
+	{
+		if (wdl & 1) dtz += 100;
+		return (wdl >= 0) ? dtz : -dtz;
+	}
+
+	//The table stores the other side to move, so search one ply
+	if (wdl > 0)
+	{
+		int best = 0xffff;
+		for (int i = 0; i < move_list.num; i++)
+		{
+			int move = move_list.list[i].move;
+			if (IS_PAWN(GET_PIECE(move)) || IS_CAPTURE(move) || !Make_Move(move, board)) continue;
+
+			int value = -TB_Probe_DTZ(board, success);
+			Take_Move(board);
+
+			if (*success == 0) return 0;
+			if (value > 0 && value + 1 < best) best = value + 1;
+		}
+		return best;
+	}
+	else
+	{
+		int best = -1;
+		for (int i = 0; i < move_list.num; i++)
+		{
+			int value, move = move_list.list[i].move;
+			if (!Make_Move(move, board)) continue;
+
+			if (board->move_counter == 0)
+			{
+				if (wdl == -2) value = -1;
+				else
+				{
+					value = Probe_AB(board, 1, 2, success);
+					value = (value == 2) ? 0 : -101;
+				}
+			}
+			else value = -TB_Probe_DTZ(board, success) - 1;
+			Take_Move(board);
+
+			if (*success == 0) return 0;
+			if (value < best) best = value;
+		}
+		return best;
+	}
+}
+
+//Returns the distance to zeroing for the side to move in plies, positive if winning and negative if losing
+//Values above 100 win or lose only if the 50 move rule is ignored, 0 is a draw
+int TB_Probe_DTZ(BOARD_STRUCT *board, int *success)
+{
+	*success = 1;
+	int value = Probe_DTZ_No_EP(board, success);
+
+	if (board->ep == NO_SQUARE || *success == 0) return (*success == 0) ? 0 : value;
+
+	int ep_value = Probe_EP_Captures(board, success);
+	if (*success == 0) return 0;
+
+	if (ep_value > -3)
+	{
+		ep_value = wdl_to_dtz[ep_value + 2];
+		if (value < -100)
+		{
+			if (ep_value >= 0) value = ep_value;
+		}
+		else if (value < 0)
+		{
+			if (ep_value >= 0 || ep_value < -100) value = ep_value;
+		}
+		else if (value > 100)
+		{
+			if (ep_value > 0) value = ep_value;
+		}
+		else if (value > 0)
+		{
+			if (ep_value == 1) value = ep_value;
+		}
+		else if (ep_value >= 0) value = ep_value;
+		else if (!Has_Legal_Move(board, 0)) value = ep_value;
+	}
+	return value;
+}
+
+//Keeps the root moves at the start of the list that keep is set for
+static void Filter_Root_Moves(ROOT_MOVE_LIST_STRUCT *root_moves, const int *keep)
+{
+	int num = 0;
+
+	for (int i = 0; i < root_moves->num; i++)
+	{
+		if (keep[i]) root_moves->list[num++] = root_moves->list[i];
+	}
+	root_moves->num = num;
+}
+
+//Removes root moves that give up the result, using dtz tables or wdl tables if they are missing
+//Returns the piece count the search should probe at, 0 once the root is filtered by dtz
+int TB_Root_Probe(BOARD_STRUCT *board, SEARCH_INFO_STRUCT *info)
+{
+	ROOT_MOVE_LIST_STRUCT *root_moves = &info->root_moves;
+	int values[MAX_MOVE_LIST_LENGTH];
+	int keep[MAX_MOVE_LIST_LENGTH];
+	int success, i;
+
+	if (!tb_largest || board->castle_rights || count_1s(board->side_bitboards[BOTH]) > tb_largest) return tb_largest;
+
+	int dtz = TB_Probe_DTZ(board, &success);
+	if (success)
+	{
+		for (i = 0; i < root_moves->num && success; i++)
+		{
+			int value = 0;
+			Make_Move(root_moves->list[i].move, board);
+
+			//Mates are not in the tables
+			if (dtz > 0 && In_Check(board->side, board) && !Has_Legal_Move(board, 1)) value = 1;
+			if (!value)
+			{
+				if (board->move_counter != 0)
+				{
+					value = -TB_Probe_DTZ(board, &success);
+					if (value > 0) value++;
+					else if (value < 0) value--;
+				}
+				else value = wdl_to_dtz[-TB_Probe_WDL(board, &success) + 2];
+			}
+
+			Take_Move(board);
+			values[i] = value;
+		}
+	}
+
+	if (success)
+	{
+		const int counter = board->move_counter;
+		int best = (dtz > 0) ? 0xffff : 0;
+
+		for (i = 0; i < root_moves->num; i++)
+		{
+			if (dtz > 0 && values[i] > 0 && values[i] < best) best = values[i];
+			if (dtz < 0 && values[i] < best) best = values[i];
+		}
+
+		if (dtz > 0)
+		{
+			//Any move that wins within the 50 move budget is fine, unless the game is already repeating
+			int max_value = (!Is_Repetition(board) && best + counter <= 99) ? 99 - counter : best;
+			for (i = 0; i < root_moves->num; i++) keep[i] = (values[i] > 0 && values[i] <= max_value);
+		}
+		else if (dtz < 0)
+		{
+			//Losing moves are all searched until the 50 move rule gets close
+			for (i = 0; i < root_moves->num; i++) keep[i] = (-best * 2 + counter < 100) || values[i] == best;
+		}
+		else
+		{
+			for (i = 0; i < root_moves->num; i++) keep[i] = (values[i] == 0);
+		}
+
+		info->tb_hits += root_moves->num;
+		Filter_Root_Moves(root_moves, keep);
+		return 0;
+	}
+
+	//Without dtz tables keep the moves with the best wdl, the search still probes to find a way to win
+	int wdl = TB_Probe_WDL(board, &success);
+	if (!success) return tb_largest;
+
+	int best = -2;
+	for (i = 0; i < root_moves->num && success; i++)
+	{
+		Make_Move(root_moves->list[i].move, board);
+		values[i] = -TB_Probe_WDL(board, &success);
+		Take_Move(board);
+		if (values[i] > best) best = values[i];
+	}
+	if (!success) return tb_largest;
+
+	for (i = 0; i < root_moves->num; i++) keep[i] = (values[i] == best);
+	info->tb_hits += root_moves->num;
+	Filter_Root_Moves(root_moves, keep);
+
+	return (wdl > 0) ? tb_largest : 0;
+}
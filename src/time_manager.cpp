@@ -0,0 +1,89 @@
+/* time_manager.cpp
+* Contains functions for deciding how long to search a move
+* Theo Kanning
+*/
+
+#include "globals.h"
+#include "windows.h"
+
+using namespace std;
+
+#define MAX_TIME_RATIO		5 //Hard limit can be this many times the optimum time
+#define FAIL_LOW_MARGIN		30 //Score drop between iterations that extends the search
+#define STABLE_ITERATIONS	4 //Iterations with the same best move before stopping early
+#define EASY_MOVE_EFFORT	90 //Percent of nodes spent on the best move that makes it an easy move
+
+//Sets the optimum and maximum stop times from the clock values in a go command
+void Set_Time_Limits(int time, int inc, int movestogo, int movetime, SEARCH_INFO_STRUCT *info)
+{
+	int optimum, maximum;
+
+	if (movetime != -1) //Fixed time, use all of it
+	{
+		optimum = movetime - move_overhead;
+		maximum = optimum;
+	}
+	else
+	{
+		int time_left = time - move_overhead;
+
+		optimum = time_left / movestogo + inc;
+		maximum = min(optimum * MAX_TIME_RATIO, time_left - time_left / 10); //Always keep a tenth of the clock
+		optimum = min(optimum, maximum);
+	}
+
+	//Always search for at least one ms
+	optimum = max(optimum, 1);
+	maximum = max(maximum, 1);
+
+	info->soft_stop_time = info->start_time + optimum;
+	info->stop_time = info->start_time + maximum;
+}
+
+//Returns 1 if a new iteration should not be started
+//stable_iterations is the number of iterations the best move has not changed, score_drop is the score loss from the previous iteration
+//best_move_effort is the percent of the last iteration's nodes spent under the best move
+int Soft_Time_Up(int stable_iterations, int score_drop, int best_move_effort, SEARCH_INFO_STRUCT *info)
+{
+	int optimum = info->soft_stop_time - info->start_time;
+
+	//Best move just changed, give it time to settle
+	if (stable_iterations == 0) optimum = optimum * 3 / 2;
+	//Same best move for several iterations, stop early
+	else if (stable_iterations >= STABLE_ITERATIONS) optimum = optimum / 2;
+
+	//Other moves were refuted quickly
+	if (best_move_effort >= EASY_MOVE_EFFORT) optimum = optimum * 3 / 4;
+
+	//Score is falling, look for a better move
+	if (score_drop > FAIL_LOW_MARGIN) optimum = optimum * 3 / 2;
+
+	return (Get_Time_Ms() - info->start_time) >= optimum;
+}
+
+
+//Moves a ponder search onto the normal clock once the gui sends ponderhit
+//The limits are shifted so the full budget starts now, the search continues without restarting
+void Check_Ponderhit(SEARCH_INFO_STRUCT *info)
+{
+	if (!info->pondering || !info->ponderhit) return;
+
+	int shift = Get_Time_Ms() - info->start_time;
+	info->start_time += shift;
+	info->soft_stop_time += shift;
+	info->stop_time += shift;
+	info->pondering = 0;
+}
+
+//Returns 1 if the search has used its time or nodes, called every 4096 nodes
+int Search_Limit_Reached(SEARCH_INFO_STRUCT *info)
+{
+	Check_Ponderhit(info);
+
+	//Time limits do not apply while pondering, move overhead is already taken off the stop time
+	if (info->time_set && !info->pondering && Get_Time_Ms() > info->stop_time) return 1;
+
+	if (info->node_limit && info->total_nodes + info->nodes >= info->node_limit) return 1;
+
+	return 0;
+}
\ No newline at end of file
@@ -6,15 +6,28 @@
 
 #include "globals.h"
 #include "string.h"
+#include <thread>
 
 #define INPUTBUFFER 400 * 6
 
+/* Searches run on their own thread so the uci loop can keep reading input */
+static std::thread search_thread;
+
+//Blocks until the current search has printed its best move
+static void Wait_For_Search(void)
+{
+	if (search_thread.joinable()) search_thread.join();
+}
+
 // go depth 6 wtime 180000 btime 100000 binc 1000 winc 1000 movetime 1000 movestogo 40
 void Parse_Go(char* line, SEARCH_INFO_STRUCT *info, BOARD_STRUCT *board) {
 
 	int depth = -1, movestogo = 30, movetime = -1;
 	int time = -1, inc = 0;
 	char *ptr = NULL;
+
+	//Clear before starting the search thread so an early stop is not lost
+	Clear_Search_Info(info);
 	info->time_set = 0;
 	info->end_early = 1;
 
@@ -22,6 +35,10 @@ void Parse_Go(char* line, SEARCH_INFO_STRUCT *info, BOARD_STRUCT *board) {
 		;
 	}
 
+	if ((ptr = strstr(line, "ponder"))) {
+		info->pondering = 1; //Clock values are used after ponderhit
+	}
+
 	if ((ptr = strstr(line, "binc")) && board->side == BLACK) {
 		inc = atoi(ptr + 5);
 	}
@@ -44,35 +61,33 @@ void Parse_Go(char* line, SEARCH_INFO_STRUCT *info, BOARD_STRUCT *board) {
 
 	if ((ptr = strstr(line, "movetime"))) {
 		movetime = atoi(ptr + 9);
-		//info->end_early = 0; //Disable ending early if specific move time is given
+		info->end_early = 0; //Disable ending early if specific move time is given
 	}
 
 	if ((ptr = strstr(line, "depth"))) {
 		depth = atoi(ptr + 6);
 	}
 
-	if (movetime != -1) {
-		time = movetime;
-		movestogo = 1;
+	if ((ptr = strstr(line, "nodes"))) {
+		info->node_limit = atol(ptr + 6);
 	}
 
 	info->start_time = Get_Time_Ms();
 	info->depth = depth;
 
-	if (time != -1) {
+	//Deterministic searches only stop on depth or nodes
+	if ((time != -1 || movetime != -1) && !deterministic) {
 		info->time_set = 1;
-		time /= movestogo;
-		time -= 10;
-		info->stop_time = info->start_time + time + inc;
+		Set_Time_Limits(time, inc, movestogo, movetime, info);
 	}
 
 	if (depth == -1) {
 		info->depth = MAX_SEARCH_DEPTH;
 	}
 
-	printf("time:%d start:%d stop:%d depth:%d timeset:%d\n", time, info->start_time, info->stop_time, info->depth, info->time_set);
+	printf("time:%d start:%d soft stop:%d stop:%d depth:%d nodes:%ld timeset:%d\n", time, info->start_time, info->soft_stop_time, info->stop_time, info->depth, info->node_limit, info->time_set);
 
-	Search_Position(board, info);
+	search_thread = std::thread(Search_Position, board, info);
 }
 
 // position fen fenstr
@@ -125,6 +140,14 @@ void Uci_Loop(BOARD_STRUCT *board, SEARCH_INFO_STRUCT *info) {
 	printf("id name %s\n", PROGRAM_NAME);
 	printf("id author %s\n", AUTHOR);
 	//printf("option name Hash type spin default 64 min 4 max 2048\n");
+	printf("option name MultiPV type spin default 1 min 1 max %d\n", MAX_MOVE_LIST_LENGTH);
+	printf("option name Ponder type check default false\n");
+	printf("option name Threads type spin default 1 min 1 max %d\n", MAX_THREADS);
+	printf("option name SMPMode type spin default 0 min 0 max 1\n");
+	printf("option name EvalFile type string default <empty>\n");
+	printf("option name SyzygyPath type string default <empty>\n");
+	printf("option name SyzygyProbe type check default false\n");
+	printf("option name UseNNUE type check default false\n");
 	printf("uciok\n");
 
 	int MB = 64;
@@ -138,11 +161,31 @@ void Uci_Loop(BOARD_STRUCT *board, SEARCH_INFO_STRUCT *info) {
 		if (line[0] == '\n')
 			continue;
 
+		//Commands that are handled while searching
 		if (!strncmp(line, "isready", 7)) {
 			printf("readyok\n");
 			continue;
 		}
-		else if (!strncmp(line, "position", 8)) {
+		else if (!strncmp(line, "stop", 4)) {
+			info->stopped = 1;
+			Wait_For_Search();
+			continue;
+		}
+		else if (!strncmp(line, "ponderhit", 9)) {
+			info->ponderhit = 1;
+			continue;
+		}
+		else if (!strncmp(line, "quit", 4)) {
+			info->quit = 1;
+			info->stopped = 1;
+			Wait_For_Search();
+			break;
+		}
+
+		//Everything else changes the board or settings, so finish the search first
+		Wait_For_Search();
+
+		if (!strncmp(line, "position", 8)) {
 			Parse_Position(line, board);
 		}
 		else if (!strncmp(line, "ucinewgame", 10)) {
@@ -152,17 +195,21 @@ void Uci_Loop(BOARD_STRUCT *board, SEARCH_INFO_STRUCT *info) {
 			printf("Seen Go..\n");
 			Parse_Go(line, info, board);
 		}
-		else if (!strncmp(line, "quit", 4)) {
-			info->quit = 1;
-			break;
-		}
 		else if (!strncmp(line, "uci", 3)) {
 			printf("id name %s\n", PROGRAM_NAME);
 			printf("id author %s\n", AUTHOR);
+			printf("option name MultiPV type spin default 1 min 1 max %d\n", MAX_MOVE_LIST_LENGTH);
+			printf("option name Ponder type check default false\n");
+			printf("option name Threads type spin default 1 min 1 max %d\n", MAX_THREADS);
+			printf("option name SMPMode type spin default 0 min 0 max 1\n");
+			printf("option name EvalFile type string default <empty>\n");
+			printf("option name SyzygyPath type string default <empty>\n");
+			printf("option name SyzygyProbe type check default false\n");
+			printf("option name UseNNUE type check default false\n");
 			printf("uciok\n");
 		}
 		else if (!strncmp(line, "setoption", 9)) {
-			Set_Option(line);
+			Set_Option(line, board);
 		}
 		
 		if (info->quit) break;